@@ -0,0 +1,162 @@
+/***************************************************************************
+ *   Copyright (C) 2007 Ryan Schultz, PCSX-df Team, PCSX team              *
+ *   schultz.ryan@gmail.com, http://rschultz.ath.cx/code.php               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+* Branches: many input scripts tried from one state, one after the other.
+* BranchRun only queues them; the execute loop then takes the state in
+* memory, with the memory cards, and plays the first script (a movie,
+* played on from the state) with the output off and no frame limit.
+* When a script ends its result is kept, the state goes back and the
+* next one starts. After the last the state goes back once more and the
+* output comes on again. Only the RAM pages a branch wrote are copied
+* back, and card writes stay in memory while branches run.
+*/
+
+#include "Branch.h"
+#include "Movie.h"
+#include "Rewind.h"
+#include "Sio.h"
+#include "Misc.h"
+
+int branchActive = 0;
+int branchDue = 0;
+
+static StateMem brState;
+static char *brMcd[2];			/* the card images of the state */
+static u32 brDirty[PSXMEM_PAGES / 32];
+static char **brScripts;
+static BranchResult *brResults;
+static int brCount, brNext;
+static u32 brFrames;
+
+// plays scripts from the state at the end of this frame, one by one, and
+// puts each's result in results; branchActive is clear again when done
+int BranchRun(char **scripts, int count, BranchResult *results) {
+	if (branchActive || count <= 0) return -1;
+
+	brScripts = scripts;
+	brResults = results;
+	brCount = count;
+	brNext = 0;
+
+	branchActive = 1;
+	branchDue = 1;
+
+	return 0;
+}
+
+static void branchResult(BranchResult *r, int status) {
+	r->status = status;
+	r->frames = brFrames;
+	r->pc = psxRegs.pc;
+	r->ramCrc = crc32(0, (Bytef *) psxM, 0x00200000);
+}
+
+static int branchBegin() {
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		if (brMcd[i] == NULL && (brMcd[i] = (char *) malloc(MCD_SIZE)) == NULL) return -1;
+	}
+	if (SnapStateMem(&brState) == -1) return -1;
+
+	memcpy(brMcd[0], Mcd1Data, MCD_SIZE);
+	memcpy(brMcd[1], Mcd2Data, MCD_SIZE);
+	memcpy(brDirty, psxMemDirty, sizeof(brDirty));
+	psxMemDirtyClear();
+
+	mcdReadOnly = 1;
+	GPU_setOutput(0);
+	SPU_setOutput(0);
+
+	return 0;
+}
+
+static void branchRestore() {
+	RestoreStateMemPages(&brState, psxMemDirty);
+	psxMemDirtyClear();
+	memcpy(Mcd1Data, brMcd[0], MCD_SIZE);
+	memcpy(Mcd2Data, brMcd[1], MCD_SIZE);
+}
+
+static void branchEnd() {
+	GPU_setOutput(1);
+	SPU_setOutput(1);
+	mcdReadOnly = 0;
+
+	// RAM is what it was, so are the pages written since the delta base
+	memcpy(psxMemDirty, brDirty, sizeof(brDirty));
+	// the rewind states are of the branches
+	RewindReset();
+
+	branchActive = 0;
+}
+
+// called every vsync; a branch whose script stopped is done
+void BranchFrame() {
+	if (!branchActive || branchDue) return;
+
+	brFrames++;
+	if (movieMode != MOVIE_PLAY) branchDue = 1;
+}
+
+// called by the execute loop between two blocks
+void BranchStep() {
+	branchDue = 0;
+	if (!branchActive) return;
+
+	if (brNext == 0) {
+		if (branchBegin() == -1) {
+			SysPrintf("Branches off: no memory for their state\n");
+			for (; brNext < brCount; brNext++) {
+				brFrames = 0;
+				branchResult(&brResults[brNext], -1);
+			}
+			branchActive = 0;
+			return;
+		}
+	} else {
+		branchResult(&brResults[brNext - 1], MovieDone() ? 0 : -1);
+		branchRestore();
+	}
+
+	for (; brNext < brCount; brNext++) {
+		brFrames = 0;
+		if (MoviePlayHere(brScripts[brNext]) == 0) {
+			brNext++;
+			return;
+		}
+		branchResult(&brResults[brNext], -1);
+	}
+
+	branchEnd();
+}
+
+void BranchShutdown() {
+	if (branchActive) {
+		MovieStop();
+		branchRestore();
+		branchEnd();
+	}
+	StateMemFree(&brState);
+	free(brMcd[0]);
+	free(brMcd[1]);
+	brMcd[0] = brMcd[1] = NULL;
+}
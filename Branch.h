@@ -0,0 +1,41 @@
+/***************************************************************************
+ *   Copyright (C) 2007 Ryan Schultz, PCSX-df Team, PCSX team              *
+ *   schultz.ryan@gmail.com, http://rschultz.ath.cx/code.php               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef __BRANCH_H__
+#define __BRANCH_H__
+
+#include "PsxCommon.h"
+
+typedef struct {
+	int status;			/* 0 the script ran to its end, -1 it didn't */
+	u32 frames;			/* frames the branch ran */
+	u32 pc;
+	u32 ramCrc;			/* crc32 of the psx RAM at the end */
+} BranchResult;
+
+extern int branchActive;	/* set while branches run */
+extern int branchDue;		/* a branch ended, the execute loop starts the next */
+
+int  BranchRun(char **scripts, int count, BranchResult *results);
+void BranchFrame();
+void BranchStep();
+void BranchShutdown();
+
+#endif /* __BRANCH_H__ */
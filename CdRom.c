@@ -23,6 +23,8 @@
 */
 
 #include "CdRom.h"
+#include "Movie.h"
+#include "RunAhead.h"
 
 /* CD-ROM magic numbers */
 #define CdlSync         0
@@ -90,16 +92,110 @@ unsigned char Test23[] = { 0x43, 0x58, 0x44, 0x32, 0x39 ,0x34, 0x30, 0x51 };
 static struct CdrStat stat;
 static struct SubQ *subq;
 
+/*
+* The last sector read is used in place, where CDR_getBuffer left it;
+* the plugin keeps it there until the next CDR_getBuffer. cdr.Transfer
+* only holds it after a read error or when a state is loaded, and gets
+* a copy when a state is saved.
+*/
+static unsigned char *cdrSector = NULL;
+
+#define cdrData() (cdrSector ? cdrSector : cdr.Transfer)
+
+/*
+* Fast load: with Config.CdrSpeedup > 1 every command and read delay is
+* divided by it, down to CDR_MIN_DELAY so the irqs still come one at a
+* time in the same order. XA streaming and cd audio keep the drive speed,
+* they are played as they arrive.
+*/
+#define CDR_MIN_DELAY 0x100
+
+static u32 cdrDelay(u32 eCycle, int realtime) {
+	if (Config.CdrSpeedup <= 1 || realtime || eCycle <= CDR_MIN_DELAY)
+		return eCycle;
+	eCycle /= Config.CdrSpeedup;
+	return eCycle < CDR_MIN_DELAY ? CDR_MIN_DELAY : eCycle;
+}
+
 #define CDR_INT(eCycle) { \
 	psxRegs.interrupt|= 0x4; \
-	psxRegs.intCycle[2+1] = eCycle; \
+	psxRegs.intCycle[2+1] = cdrDelay(eCycle, cdr.Play); \
 	psxRegs.intCycle[2] = psxRegs.cycle; }
 
 #define CDREAD_INT(eCycle) { \
 	psxRegs.interrupt|= 0x40000; \
-	psxRegs.intCycle[2+16+1] = eCycle; \
+	psxRegs.intCycle[2+16+1] = cdrDelay(eCycle, cdr.Mode & 0x40); \
 	psxRegs.intCycle[2+16] = psxRegs.cycle; }
 
+#ifdef THREADED_AUDIO
+/*
+* XA decode-ahead: the XA sectors are queued here, and a low priority
+* thread decodes them and hands them to the SPU. It gets the cpu while
+* the emu thread waits for the vsync, so streamed audio doesn't add to
+* the frame time on every sector. cdr.Xa belongs to that thread while
+* sectors are queued, xaFlush() takes it back.
+*/
+#include <ogc/lwp.h>
+#include <ogc/semaphore.h>
+
+#define XA_QUEUE		16
+#define XA_SECTOR		2336	/* subheader + data, as in cdr.Transfer+4 */
+#define XA_STACK_SIZE	8192
+#define XA_PRIORITY		60		/* below the emu thread */
+
+typedef struct {
+	unsigned char sector[XA_SECTOR];
+	int first;
+} xaSector;
+
+static xaSector xaQueue[XA_QUEUE];
+static int xaHead = 0, xaTail = 0;
+static sem_t xaFull, xaFree;
+static lwp_t xaThread;
+static int xaRunning = 0;
+static char xaStack[XA_STACK_SIZE];
+
+static void *xaDecodeThread(void *arg) {
+	while (1) {
+		LWP_SemWait(xaFull);
+
+		if (!xa_decode_sector(&cdr.Xa, xaQueue[xaTail].sector, xaQueue[xaTail].first))
+			SPU_playADPCMchannel(&cdr.Xa);
+
+		xaTail = (xaTail + 1) % XA_QUEUE;
+		LWP_SemPost(xaFree);
+	}
+	return NULL;
+}
+
+static void xaQueueSector(unsigned char *sector, int first) {
+	if (!xaRunning) {
+		LWP_SemInit(&xaFull, 0, XA_QUEUE);
+		LWP_SemInit(&xaFree, XA_QUEUE, XA_QUEUE);
+		xaHead = xaTail = 0;
+		xaRunning = 1;
+		LWP_CreateThread(&xaThread, xaDecodeThread, NULL, xaStack, XA_STACK_SIZE, XA_PRIORITY);
+	}
+
+	// Only waits if the thread is a whole queue behind
+	LWP_SemWait(xaFree);
+	memcpy(xaQueue[xaHead].sector, sector, XA_SECTOR);
+	xaQueue[xaHead].first = first;
+	xaHead = (xaHead + 1) % XA_QUEUE;
+	LWP_SemPost(xaFull);
+}
+
+static void xaFlush() {
+	int i;
+
+	if (!xaRunning) return;
+
+	// Once we hold every free slot, all queued sectors are decoded
+	for (i=0; i<XA_QUEUE; i++) LWP_SemWait(xaFree);
+	for (i=0; i<XA_QUEUE; i++) LWP_SemPost(xaFree);
+}
+#endif
+
 #define StartReading(type) { \
    	cdr.Reading = type; \
   	cdr.FirstSector = 1; \
@@ -114,9 +210,19 @@ static struct SubQ *subq;
 	} \
 }
 
+// the ahead frames of run-ahead are thrown away, so they leave the cd
+// audio alone; the plugin keeps playing what the real frames started
+static void cdrPlay(unsigned char *time) {
+	if (!runAheadActive) CDR_play(time);
+}
+
+static void cdrStop() {
+	if (!runAheadActive) CDR_stop();
+}
+
 #define StopCdda() { \
 	if (cdr.Play) { \
-		if (!Config.Cdda) CDR_stop(); \
+		if (!Config.Cdda) cdrStop(); \
 		cdr.StatP&=~0x80; \
 		cdr.Play = 0; \
 	} \
@@ -323,7 +429,7 @@ void cdrInterrupt() {
     	case CdlGetlocL:
 			SetResultSize(8);
 //        	for (i=0; i<8; i++) cdr.Result[i] = itob(cdr.Transfer[i]);
-        	for (i=0; i<8; i++) cdr.Result[i] = cdr.Transfer[i];
+        	for (i=0; i<8; i++) cdr.Result[i] = cdrData()[i];
         	cdr.Stat = Acknowledge;
         	break;
 
@@ -586,6 +692,7 @@ void cdrReadInterrupt() {
 #ifdef CDR_LOG
 		fprintf(emuLog, "cdrReadInterrupt() Log: err\n");
 #endif
+		cdrSector = NULL;
 		memset(cdr.Transfer, 0, 2340);
 		cdr.Stat = DiskError;
 		cdr.Result[0]|= 0x01;
@@ -594,24 +701,36 @@ void cdrReadInterrupt() {
 		return;
 	}
 
-	memcpy(cdr.Transfer, buf, 2340);
+	cdrSector = buf;
     cdr.Stat = DataReady;
 
 #ifdef CDR_LOG
-	fprintf(emuLog, "cdrReadInterrupt() Log: cdr.Transfer %x:%x:%x\n", cdr.Transfer[0], cdr.Transfer[1], cdr.Transfer[2]);
+	fprintf(emuLog, "cdrReadInterrupt() Log: cdr.Transfer %x:%x:%x\n", buf[0], buf[1], buf[2]);
 #endif
 
 	if ((cdr.Muted == 1) && (cdr.Mode & 0x40) && (!Config.Xa) && (cdr.FirstSector != -1)) { // CD-XA
-		if ((cdr.Transfer[4+2] & 0x4) &&
-			((cdr.Mode&0x8) ? (cdr.Transfer[4+1] == cdr.Channel) : 1) &&
-			(cdr.Transfer[4+0] == cdr.File)) {
-			int ret = xa_decode_sector(&cdr.Xa, cdr.Transfer+4, cdr.FirstSector);
+		if ((buf[4+2] & 0x4) &&
+			((cdr.Mode&0x8) ? (buf[4+1] == cdr.Channel) : 1) &&
+			(buf[4+0] == cdr.File)) {
+#ifdef THREADED_AUDIO
+			int ret = xa_check_sector(buf+4, cdr.FirstSector);
+
+			if (!ret) {
+				xaQueueSector(buf+4, cdr.FirstSector);
+				// a movie needs the sector in the SPU at the same point every time
+				if (movieMode) xaFlush();
+				cdr.FirstSector = 0;
+			}
+			else cdr.FirstSector = -1;
+#else
+			int ret = xa_decode_sector(&cdr.Xa, buf+4, cdr.FirstSector);
 
 			if (!ret) {
 				SPU_playADPCMchannel(&cdr.Xa);
 				cdr.FirstSector = 0;
 			}
 			else cdr.FirstSector = -1;
+#endif
 		}
 	}
 
@@ -627,7 +746,7 @@ void cdrReadInterrupt() {
 
     cdr.Readed = 0;
 
-	if ((cdr.Transfer[4+2] & 0x80) && (cdr.Mode & 0x2)) { // EOF
+	if ((buf[4+2] & 0x80) && (cdr.Mode & 0x2)) { // EOF
 #ifdef CDR_LOG
 		CDR_LOG("cdrReadInterrupt() Log: Autopausing read\n");
 #endif
@@ -754,11 +873,14 @@ void cdrWrite1(unsigned char rt) {
 		               	int tmp = cdr.ResultTD[2];
                         cdr.ResultTD[2] = cdr.ResultTD[0];
 						cdr.ResultTD[0] = tmp;
-	                    if (!Config.Cdda) CDR_play(cdr.ResultTD);
+						// CDR_play takes the time like SetSector, not BCD
+						for (i=0; i<2; i++) cdr.ResultTD[i] = btoi(cdr.ResultTD[i]);
+						cdr.ResultTD[2] = 0;
+	                    if (!Config.Cdda) cdrPlay(cdr.ResultTD);
 					}
                 }
 			}
-    		else if (!Config.Cdda) CDR_play(cdr.SetSector);
+    		else if (!Config.Cdda) cdrPlay(cdr.SetSector);
     		cdr.Play = 1;
 			cdr.Ctrl|= 0x80;
     		cdr.Stat = NoIntr; 
@@ -999,7 +1121,7 @@ void cdrWrite3(unsigned char rt) {
 	}
 	if (rt == 0x80 && !(cdr.Ctrl & 0x1) && cdr.Readed == 0) {
 		cdr.Readed = 1;
-		cdr.pTransfer = cdr.Transfer;
+		cdr.pTransfer = cdrData();
 
 		switch (cdr.Mode&0x30) {
 			case 0x10:
@@ -1038,6 +1160,7 @@ void psxDma3(u32 madr, u32 bcr, u32 chcr) {
 			}
 			memcpy(ptr, cdr.pTransfer, cdsize);
 			psxCpu->Clear(madr, cdsize/4);
+			psxMemMarkDirtyRange(madr, cdsize);
 			cdr.pTransfer+= cdsize;
 
 			break;
@@ -1053,19 +1176,49 @@ void psxDma3(u32 madr, u32 bcr, u32 chcr) {
 }
 
 void cdrReset() {
+#ifdef THREADED_AUDIO
+	xaFlush();
+#endif
+	StopCdda();
 	memset(&cdr, 0, sizeof(cdr));
+	cdrSector = NULL;
 	cdr.CurTrack=1;
 	cdr.File=1; cdr.Channel=1;
 }
 
-int cdrFreeze(gzFile f, int Mode) {
+int cdrFreeze(freezeFile *f, int Mode) {
 	uintptr_t tmp;
+	unsigned char playPos[4];
 
+#ifdef THREADED_AUDIO
+	xaFlush();
+#endif
+	if (Mode == 1) {
+		// the state keeps the sector itself, the plugin's copy goes
+		tmp = cdr.pTransfer - cdrData();
+		if (cdrSector) memcpy(cdr.Transfer, cdrSector, 2340);
+	}
 	gzfreeze(&cdr, sizeof(cdr));
 
-	if (Mode == 1) tmp = cdr.pTransfer - cdr.Transfer;
 	gzfreezel(&tmp);
-	if (Mode == 0) cdr.pTransfer = cdr.Transfer + tmp;
+	if (Mode == 0) {
+		cdrSector = NULL;
+		cdr.pTransfer = cdr.Transfer + tmp;
+	}
+
+	// where the plugin's cd audio was, zero when it wasn't playing
+	memset(playPos, 0, 4);
+	if (Mode == 1 && cdr.Play && !Config.Cdda) CDR_getPlayPos(playPos);
+	// STv3 files and version 1 CDR sections lack it
+	if (!f->v3 && f->version != 1) gzfreeze(playPos, 4);
+
+	// the plugin streams on by itself, so it's set to the state's cd audio;
+	// the state run-ahead goes back to is the one the plugin never left
+	if (Mode == 0 && !Config.Cdda) {
+		if (!cdr.Play) cdrStop();
+		else if (playPos[0] | playPos[1] | playPos[2]) cdrPlay(playPos);
+		else cdrPlay(cdr.SetSector);
+	}
 
 	return 0;
 }
@@ -83,38 +83,42 @@ void ADPCM_InitDecode(ADPCM_Decode_t *decp) {
 #define IK1(fid)	(-K1[fid])
 #endif
 
-static __inline void ADPCM_DecodeBlock16( ADPCM_Decode_t *decp, u8 filter_range, const void *vblockp, short *destp, int inc ) {
+/* 
+* The sound units are decoded straight out of the sector data: no
+* 16 bit gather pass, and the filter coefs are looked up once per block.
+*/
+#define XA_DECODE_NIBBLE(_N_) { \
+	s32 x = (s32)(short)((_N_) << 12) >> range; x <<= SH; \
+	x -= (k0 * fy0 + k1 * fy1) >> SHC; fy1 = fy0; fy0 = x; \
+	XACLAMP( x, -32768<<SH, 32767<<SH ); *destp = x >> SH; destp += inc; \
+}
+
+// 4 bit sound unit: one nibble (shift 0 or 4) of every 4th byte
+static __inline void ADPCM_DecodeBlock4( ADPCM_Decode_t *decp, u8 filter_range, const u8 *srcp, int shift, short *destp, int inc ) {
+	int i;
+	const int filterid = (filter_range >>  4) & 0x0f;
+	const int range    = (filter_range >>  0) & 0x0f;
+	const s32 k0 = IK0(filterid), k1 = IK1(filterid);
+	s32 fy0 = decp->y0, fy1 = decp->y1;
+
+	for (i = BLKSIZ; i; --i, srcp += 4) {
+		XA_DECODE_NIBBLE( (*srcp >> shift) & 0x0f );
+	}
+	decp->y0 = fy0;
+	decp->y1 = fy1;
+}
+
+// 8 bit sound unit: both nibbles (low first) of every 4th byte
+static __inline void ADPCM_DecodeBlock8( ADPCM_Decode_t *decp, u8 filter_range, const u8 *srcp, short *destp, int inc ) {
 	int i;
-	int range, filterid;
-	s32 fy0, fy1;
-	const u16 *blockp;
-
-	blockp = (const unsigned short *)vblockp;
-	filterid = (filter_range >>  4) & 0x0f;
-	range    = (filter_range >>  0) & 0x0f;
-
-	fy0 = decp->y0;
-	fy1 = decp->y1;
-
-	for (i = BLKSIZ/4; i; --i) {
-		s32 y;
-		s32 x0, x1, x2, x3;
-
-		y = *blockp++;
-		x3 = (short)( y        & 0xf000) >> range; x3 <<= SH;
-		x2 = (short)((y <<  4) & 0xf000) >> range; x2 <<= SH;
-		x1 = (short)((y <<  8) & 0xf000) >> range; x1 <<= SH;
-		x0 = (short)((y << 12) & 0xf000) >> range; x0 <<= SH;
-
-		x0 -= (IK0(filterid) * fy0 + (IK1(filterid) * fy1)) >> SHC; fy1 = fy0; fy0 = x0;
-		x1 -= (IK0(filterid) * fy0 + (IK1(filterid) * fy1)) >> SHC; fy1 = fy0; fy0 = x1;
-		x2 -= (IK0(filterid) * fy0 + (IK1(filterid) * fy1)) >> SHC; fy1 = fy0; fy0 = x2;
-		x3 -= (IK0(filterid) * fy0 + (IK1(filterid) * fy1)) >> SHC; fy1 = fy0; fy0 = x3;
-
-		XACLAMP( x0, -32768<<SH, 32767<<SH ); *destp = x0 >> SH; destp += inc;
-		XACLAMP( x1, -32768<<SH, 32767<<SH ); *destp = x1 >> SH; destp += inc;
-		XACLAMP( x2, -32768<<SH, 32767<<SH ); *destp = x2 >> SH; destp += inc;
-		XACLAMP( x3, -32768<<SH, 32767<<SH ); *destp = x3 >> SH; destp += inc;
+	const int filterid = (filter_range >>  4) & 0x0f;
+	const int range    = (filter_range >>  0) & 0x0f;
+	const s32 k0 = IK0(filterid), k1 = IK1(filterid);
+	s32 fy0 = decp->y0, fy1 = decp->y1;
+
+	for (i = BLKSIZ/2; i; --i, srcp += 4) {
+		XA_DECODE_NIBBLE( *srcp & 0x0f );
+		XA_DECODE_NIBBLE( *srcp >> 4 );
 	}
 	decp->y0 = fy0;
 	decp->y1 = fy1;
@@ -125,9 +129,8 @@ static int headtable[4] = {0,2,8,10};
 //===========================================
 static void xa_decode_data( xa_decode_t *xdp, unsigned char *srcp ) {
 	const u8    *sound_groupsp;
-	const u8    *sound_datap, *sound_datap2;
-	int         i, j, k, nbits;
-	u16			data[4096], *datap;
+	const u8    *sound_datap;
+	int         i, j, nbits;
 	short		*destp;
 
 	destp = xdp->pcm;
@@ -140,125 +143,60 @@ static void xa_decode_data( xa_decode_t *xdp, unsigned char *srcp ) {
 				sound_datap = sound_groupsp + 16;	// sound data just after the header
 
 				for (i=0; i < nbits; i++) {
-    				datap = data;
-    				sound_datap2 = sound_datap + i;
-
-					for (k=0; k < 14; k++, sound_datap2 += 8) {
-        	   				*(datap++) = (u16)sound_datap2[0] |
-        	               			     (u16)(sound_datap2[4] << 8);
-					}
-
-    				ADPCM_DecodeBlock16( &xdp->left,  sound_groupsp[headtable[i]+0], data,
-        	           				    destp+0, 2 );
-
-        			datap = data;
-        			sound_datap2 = sound_datap + i;
-        			for (k=0; k < 14; k++, sound_datap2 += 8) {
-           					*(datap++) = (u16)sound_datap2[0] |
-            	          			     (u16)(sound_datap2[4] << 8);
-					}
-					ADPCM_DecodeBlock16( &xdp->right,  sound_groupsp[headtable[i]+1], data,
-                           			    destp+1, 2 );
-
-	        		destp += 28*2;
+					ADPCM_DecodeBlock8( &xdp->left,  sound_groupsp[headtable[i]+0], sound_datap + i,
+					                    destp+0, 2 );
+					ADPCM_DecodeBlock8( &xdp->right, sound_groupsp[headtable[i]+1], sound_datap + i,
+					                    destp+1, 2 );
+
+					destp += 28*2;
 				}
-    		}
+			}
 		} else { // level B/C
 			for (j=0; j < 18; j++) {
 				sound_groupsp = srcp + j * 128;		// sound groups header
 				sound_datap = sound_groupsp + 16;	// sound data just after the header
 
 				for (i=0; i < nbits; i++) {
-	    			datap = data;
-	    			sound_datap2 = sound_datap + i;
-
-        			for (k=0; k < 7; k++, sound_datap2 += 16) {
-           					*(datap++) = (u16)(sound_datap2[ 0] & 0x0f) |
-                       				    ((u16)(sound_datap2[ 4] & 0x0f) <<  4) |
-                       				    ((u16)(sound_datap2[ 8] & 0x0f) <<  8) |
-                       				    ((u16)(sound_datap2[12] & 0x0f) << 12);
-					}
-	    			ADPCM_DecodeBlock16( &xdp->left,  sound_groupsp[headtable[i]+0], data,
-                   				    destp+0, 2 );
-
-	        		datap = data;
-	        		sound_datap2 = sound_datap + i;
-        			for (k=0; k < 7; k++, sound_datap2 += 16) {
-           					*(datap++) = (u16)(sound_datap2[ 0] >> 4) |
-                       	    			((u16)(sound_datap2[ 4] >> 4) <<  4) |
-                       				    ((u16)(sound_datap2[ 8] >> 4) <<  8) |
-                       				    ((u16)(sound_datap2[12] >> 4) << 12);
-					}
-					ADPCM_DecodeBlock16( &xdp->right,  sound_groupsp[headtable[i]+1], data,
-                           			    destp+1, 2 );
-
-	        		destp += 28*2;
+					ADPCM_DecodeBlock4( &xdp->left,  sound_groupsp[headtable[i]+0], sound_datap + i, 0,
+					                    destp+0, 2 );
+					ADPCM_DecodeBlock4( &xdp->right, sound_groupsp[headtable[i]+1], sound_datap + i, 4,
+					                    destp+1, 2 );
+
+					destp += 28*2;
 				}
-	    	}
+			}
 		}
 	} else { // mono
 		if ((xdp->nbits == 8) && (xdp->freq == 37800)) { // level A
 			for (j=0; j < 18; j++) {
-    			sound_groupsp = srcp + j * 128;		// sound groups header
-    			sound_datap = sound_groupsp + 16;	// sound data just after the header
-
-    			for (i=0; i < nbits; i++) {
-        			datap = data;
-        			sound_datap2 = sound_datap + i;
-        			for (k=0; k < 14; k++, sound_datap2 += 8) {
-           					*(datap++) = (u16)sound_datap2[0] |
-                       				     (u16)(sound_datap2[4] << 8);
-					}
-	        		ADPCM_DecodeBlock16( &xdp->left,  sound_groupsp[headtable[i]+0], data,
-                           			    destp, 1 );
-
-	        		destp += 28;
-
-	        		datap = data;
-	        		sound_datap2 = sound_datap + i;
-        			for (k=0; k < 14; k++, sound_datap2 += 8) {
-           					*(datap++) = (u16)sound_datap2[0] |
-                       				     (u16)(sound_datap2[4] << 8);
-					}
-	       			ADPCM_DecodeBlock16( &xdp->left,  sound_groupsp[headtable[i]+1], data,
-                           			    destp, 1 );
+				sound_groupsp = srcp + j * 128;		// sound groups header
+				sound_datap = sound_groupsp + 16;	// sound data just after the header
+
+				for (i=0; i < nbits; i++) {
+					ADPCM_DecodeBlock8( &xdp->left, sound_groupsp[headtable[i]+0], sound_datap + i,
+					                    destp, 1 );
+					destp += 28;
 
+					ADPCM_DecodeBlock8( &xdp->left, sound_groupsp[headtable[i]+1], sound_datap + i,
+					                    destp, 1 );
 					destp += 28;
 				}
-	    	}
+			}
 		} else { // level B/C
 			for (j=0; j < 18; j++) {
-	    		sound_groupsp = srcp + j * 128;		// sound groups header
-	    		sound_datap = sound_groupsp + 16;	// sound data just after the header
-
-	    		for (i=0; i < nbits; i++) {
-	        		datap = data;
-	        		sound_datap2 = sound_datap + i;
-        			for (k=0; k < 7; k++, sound_datap2 += 16) {
-           					*(datap++) = (u16)(sound_datap2[ 0] & 0x0f) |
-                       				    ((u16)(sound_datap2[ 4] & 0x0f) <<  4) |
-                       				    ((u16)(sound_datap2[ 8] & 0x0f) <<  8) |
-                       				    ((u16)(sound_datap2[12] & 0x0f) << 12);
-					}
-	        		ADPCM_DecodeBlock16( &xdp->left,  sound_groupsp[headtable[i]+0], data,
-                           			    destp, 1 );
-
-	        		destp += 28;
-
-	        		datap = data;
-	        		sound_datap2 = sound_datap + i;
-        			for (k=0; k < 7; k++, sound_datap2 += 16) {
-            				*(datap++) = (u16)(sound_datap2[ 0] >> 4) |
-                       	    		    ((u16)(sound_datap2[ 4] >> 4) <<  4) |
-                        				((u16)(sound_datap2[ 8] >> 4) <<  8) |
-                        				((u16)(sound_datap2[12] >> 4) << 12);
-        			}
-	       			ADPCM_DecodeBlock16( &xdp->left,  sound_groupsp[headtable[i]+1], data,
-                           			    destp, 1 );
+				sound_groupsp = srcp + j * 128;		// sound groups header
+				sound_datap = sound_groupsp + 16;	// sound data just after the header
 
+				for (i=0; i < nbits; i++) {
+					ADPCM_DecodeBlock4( &xdp->left, sound_groupsp[headtable[i]+0], sound_datap + i, 0,
+					                    destp, 1 );
+					destp += 28;
+
+					ADPCM_DecodeBlock4( &xdp->left, sound_groupsp[headtable[i]+1], sound_datap + i, 4,
+					                    destp, 1 );
 					destp += 28;
 				}
-    		}
+			}
 		}
 	}
 }
@@ -349,6 +287,20 @@ s32 xa_decode_sector( xa_decode_t *xdp,
 	return 0;
 }
 
+//================================================================
+//=== Same check as xa_decode_sector, but without decoding: lets the
+//=== caller decode the sector later (on another thread)
+//=== return -1 if error
+//================================================================
+s32 xa_check_sector( unsigned char *sectorp, int is_first_sector ) {
+	xa_subheader_t *subheadp = (xa_subheader_t *)sectorp;
+
+	if ( is_first_sector && AUDIO_CODING_GET_FREQ(subheadp->coding) > 1 )
+		return -1;
+
+	return 0;
+}
+
 /* EXAMPLE:
 "nsamples" is the number of 16 bit samples
 every sample is 2 bytes in mono and 4 bytes in stereo
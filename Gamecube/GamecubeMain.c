@@ -27,6 +27,8 @@
 #include <time.h>
 #include <fat.h>
 #include "PsxCommon.h"
+#include "Rewind.h"
+#include "Movie.h"
 #include "PlugCD.h"
 #include "DEBUG.h"
 
@@ -51,6 +53,22 @@ extern int controllerType;
 
 int stop = 0;
 
+// The reset and power buttons come in on interrupts, where there's no
+// file I/O; SysUpdate shuts down on the next vsync instead, which writes
+// the memory cards (and a state in flight) out before we leave.
+static volatile int resetPressed = 0;
+static volatile int powerPressed = 0;
+
+static void ResetCallback() {
+  resetPressed = 1;
+}
+
+#ifdef HW_RVL
+static void PowerCallback() {
+  powerPressed = 1;
+}
+#endif
+
 void ScanPADSandReset() { 
   PAD_ScanPads(); 
   if(!((*(u32*)0xCC003000)>>16)) 
@@ -138,6 +156,10 @@ int main(int argc, char *argv[]) {
 
 	Initialise();
 	fatInitDefault();
+	SYS_SetResetCallback(ResetCallback);
+#ifdef HW_RVL
+	SYS_SetPowerCallback(PowerCallback);
+#endif
     draw_splash();
 	
   /* Configure pcsx */
@@ -178,8 +200,14 @@ int main(int argc, char *argv[]) {
 	Config.PsxOut = 1;
 	Config.HLE = 1;
 	Config.Xa = 0;  //XA enabled
-	Config.Cdda = 1;
+	Config.Cdda = 0; //CDDA enabled
 	Config.PsxAuto = 1; //Autodetect
+	Config.CdrSpeedup = 0; //Real drive speed
+	Config.Rewind = 0; //No rewind
+	Config.RunAhead = 0; //No run-ahead
+	Config.McdSync = 1; //fsync the memory cards
+	Config.BiosCache = 1; //Boot from the cached post-BIOS state
+	Config.AutoSave = 0; //No autosave, 300 = every 5 seconds
     SysPrintf("start main()\r\n");
 
 	if (SysInit() == -1) 
@@ -194,6 +222,7 @@ int main(int argc, char *argv[]) {
   SysPrintf("CheckCdrom\r\n");
 	CheckCdrom();
 	LoadCdrom();
+	if (Config.AutoSave) LoadAutoState();
 
 	
   SysPrintf("Execute\r\n");
@@ -274,6 +303,15 @@ void SysCloseLibrary(void *lib) {
 
 int framesdone = 0;
 void SysUpdate() {
+	if (resetPressed || powerPressed) {
+		SysClose();
+#ifdef HW_RVL
+		if (powerPressed) SYS_ResetSystem(SYS_POWEROFF, 0, 0);
+#endif
+		exit(0);
+	}
+	// Z alone steps back, with a rewind buffer and no movie to keep in step
+	RewindHold(movieMode == MOVIE_OFF && PAD_ButtonsHeld(0) == PAD_TRIGGER_Z);
 	//framesdone++;
 //	PADhandleKey(PAD1_keypressed());
 //	PADhandleKey(PAD2_keypressed());
@@ -77,6 +77,9 @@ void CALLBACK PEOPS_SPUwriteDMAMem(unsigned short * pusPSXMem,int iSize);
 void CALLBACK PEOPS_SPUasync(unsigned long cycle);
 void CALLBACK PEOPS_SPUupdate(void);
 void CALLBACK PEOPS_SPUplayADPCMchannel(xa_decode_t *xap);
+long CALLBACK PEOPS_SPUplayCDDAchannel(short *pcm, int nbytes);
+void CALLBACK PEOPS_SPUsetOutput(int iOn);
+void CALLBACK PEOPS_SPUsetDeterministic(int iOn);
 long CALLBACK PEOPS_SPUinit(void);
 long PEOPS_SPUopen(void);
 void PEOPS_SPUsetConfigFile(char * pCfg);
@@ -104,6 +107,9 @@ long CDR__getTD(unsigned char , unsigned char *);
 long CDR__readTrack(unsigned char *);
 unsigned char *CDR__getBuffer(void);
 unsigned char *CDR__getBufferSub(void);
+long CDR__play(unsigned char *);
+long CDR__stop(void);
+long CDR__getPlayPos(unsigned char *);
 
 /* NULL GPU */
 //typedef long (* GPUopen)(unsigned long *, char *, char *);
@@ -131,6 +137,8 @@ unsigned long PEOPS_GPUreadData(void);
 void PEOPS_GPUreadDataMem(unsigned long *, int);
 long PEOPS_GPUdmaChain(unsigned long *,unsigned long);
 void PEOPS_GPUupdateLace(void);
+void PEOPS_GPUsetOutput(int);
+void PEOPS_GPUsetDeterministic(int);
 void PEOPS_GPUdisplayText(char *);
 long PEOPS_GPUfreeze(unsigned long,GPUFreeze_t *);
 
@@ -172,7 +180,7 @@ long PEOPS_GPUfreeze(unsigned long,GPUFreeze_t *);
 
 #define CDR_PLUGIN \
 	{ "CDR",      \
-	  9,         \
+	  12,         \
 	  { { "CDRinit",  \
 	      CDR__init }, \
 	    { "CDRshutdown",	\
@@ -190,7 +198,13 @@ long PEOPS_GPUfreeze(unsigned long,GPUFreeze_t *);
 	    { "CDRgetBuffer", \
 	      CDR__getBuffer}, \
 	    { "CDRgetBufferSub", \
-	      CDR__getBufferSub} \
+	      CDR__getBufferSub}, \
+	    { "CDRplay", \
+	      CDR__play}, \
+	    { "CDRstop", \
+	      CDR__stop}, \
+	    { "CDRgetPlayPos", \
+	      CDR__getPlayPos} \
 	       } }
 
 #define SPU_NULL_PLUGIN \
@@ -234,7 +248,7 @@ long PEOPS_GPUfreeze(unsigned long,GPUFreeze_t *);
 
 #define SPU_PEOPS_PLUGIN \
 	{ "SPU",      \
-	  18,         \
+	  21,         \
 	  { { "SPUinit",  \
 	      PEOPS_SPUinit }, \
 	    { "SPUshutdown",	\
@@ -270,7 +284,13 @@ long PEOPS_GPUfreeze(unsigned long,GPUFreeze_t *);
 	    { "SPUregisterCDDAVolume", \
 	      PEOPS_SPUregisterCDDAVolume}, \
 	    { "SPUasync", \
-	      PEOPS_SPUasync} \
+	      PEOPS_SPUasync}, \
+	    { "SPUplayCDDAchannel", \
+	      PEOPS_SPUplayCDDAchannel}, \
+	    { "SPUsetOutput", \
+	      PEOPS_SPUsetOutput}, \
+	    { "SPUsetDeterministic", \
+	      PEOPS_SPUsetDeterministic} \
 	       } }
       
 #define GPU_NULL_PLUGIN \
@@ -300,7 +320,7 @@ long PEOPS_GPUfreeze(unsigned long,GPUFreeze_t *);
 
 #define GPU_PEOPS_PLUGIN \
 	{ "GPU",      \
-	  14,         \
+	  16,         \
 	  { { "GPUinit",  \
 	      PEOPS_GPUinit }, \
 	    { "GPUshutdown",	\
@@ -328,7 +348,11 @@ long PEOPS_GPUfreeze(unsigned long,GPUFreeze_t *);
 	    { "GPUfreeze", \
 	      PEOPS_GPUfreeze}, \
 	    { "GPUupdateLace", \
-	      PEOPS_GPUupdateLace} \
+	      PEOPS_GPUupdateLace}, \
+	    { "GPUsetOutput", \
+	      PEOPS_GPUsetOutput}, \
+	    { "GPUsetDeterministic", \
+	      PEOPS_GPUsetDeterministic} \
 	       } }
 
 #define PLUGIN_SLOT_0 EMPTY_PLUGIN
@@ -34,5 +34,10 @@
 #define FONTWORK_LO   (FONT_HI)
 #define FONTWORK_HI   (FONTWORK_LO + FONTWORK_SIZE)
 
+// The rest, about 52MB, for preloading the CD image
+#define CDPRELOAD_LO   (FONTWORK_HI)
+#define CDPRELOAD_HI   (MEM2_HI)
+#define CDPRELOAD_SIZE (CDPRELOAD_HI - CDPRELOAD_LO)
+
 
 #endif
@@ -1,7 +1,5 @@
 /* 	super basic CD plugin for PCSX Gamecube
 	by emu_kidid based on the DC port
-	
-	TODO: Fix Missing CDDA support(?)
 */
 #include <gccore.h>
 #include <malloc.h>
@@ -14,12 +12,49 @@
 #include <gccore.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <zlib.h>
 #include "plugins.h"
 #include "PlugCD.h"
 #include "PsxCommon.h"
+#include "CdRom.h"
+#ifdef HW_RVL
+#include "MEM2.h"
+#endif
+
+#ifdef __GAMECUBE__
+#define CD_READAHEAD
+#define CD_CDDA
+#define CD_THREADED     // the image files are read from more than one thread
+#endif
+
+#ifdef CD_THREADED
+static sem_t cdFile;
+#define lockFiles()   LWP_SemWait(cdFile)
+#define unlockFiles() LWP_SemPost(cdFile)
+#else
+#define lockFiles()
+#define unlockFiles()
+#endif
 
 extern void SysPrintf(char *fmt, ...);
 
+// compressed (IndexZ) image state, see PlugCD.h for the format
+static struct
+{
+	unsigned long* offsets; // chunks + 1 file offsets
+	long chunks;
+	long chunkSectors;
+	unsigned char* zbuf;    // one compressed chunk
+	unsigned long zbufSize;
+	struct
+	{
+		long chunk;
+		unsigned long used;
+		unsigned char* data;
+	} cache[Z_CACHE_CHUNKS];
+	unsigned long useCount;
+} Z;
+
 // gets track 
 long getTN(unsigned char* buffer)
 {
@@ -76,10 +111,68 @@ long getTD(int track, unsigned char* buffer)
 	return 0;
 }
 
+// fills the track list with a single Mode2 track of the given length
+static void setSingleTrack(long blocks)
+{
+	// put the track length info in the track list
+	CD.tl = (Track*) malloc(sizeof(Track));
+	
+	CD.tl[0].type = Mode2;
+	CD.tl[0].num = 1;
+	CD.tl[0].start[0] = 0;
+	CD.tl[0].start[1] = 0;
+	CD.tl[0].start[2] = 0;
+	CD.tl[0].end[2] = blocks % 75;
+	CD.tl[0].end[1] = ((blocks - CD.tl[0].end[2]) / 75) % 60;
+	CD.tl[0].end[0] = (((blocks - CD.tl[0].end[2]) / 75) - CD.tl[0].end[1]) / 60;
+	
+	CD.tl[0].start[1] += 2;
+	CD.tl[0].end[1] += 2;
+	
+	normalizeTime(CD.tl[0].end);
+	
+	CD.numtracks = 1;
+	
+	CD.bufferSize = 0;
+    CD.bufferPos = 0x7FFFFFFF;
+  //  CD.status = 0x00;
+}
+
+// adds an image file holding sectors from the disc sector start on
+static void addFile(FILE* f, long start, long sectors, int sectorSize)
+{
+	CD.files = realloc(CD.files, (CD.numfiles + 1) * sizeof(CDFile));
+	CD.files[CD.numfiles].f = f;
+	CD.files[CD.numfiles].start = start;
+	CD.files[CD.numfiles].sectors = sectors;
+	CD.files[CD.numfiles].sectorSize = sectorSize;
+	CD.numfiles++;
+}
+
+static void closeFiles(void)
+{
+	int i;
+	
+	for (i = 0; i < CD.numfiles; i++)
+		fclose(CD.files[i].f);
+	free(CD.files);
+	CD.files = NULL;
+	CD.numfiles = 0;
+	CD.cd = NULL;
+}
+
+// converts a number of sectors to a (non-BCD) time
+static void sectorsToTime(long sectors, unsigned char* t)
+{
+	t[0] = sectors / 75 / 60;
+	t[1] = sectors / 75 % 60;
+	t[2] = sectors % 75;
+}
+
 // opens a binary cd image and calculates its length
 void openBin(const char* filename)
 {
-	long size, blocks;
+	long size;
 	struct stat fileInfo;
 	CD.cd = fopen(filename, "rb");
 		
@@ -94,30 +187,481 @@ void openBin(const char* filename)
 	SysPrintf("size of CD in MB = %d\r\n",size/1048576);
 	
 	rc = fseek(CD.cd, 0, SEEK_SET);
-	blocks = size / 2352;
+	addFile(CD.cd, 0, size / 2352, 2352);
+	setSingleTrack(size / 2352);
+}
+
+// opens a 2048 byte per sector iso, the raw sectors are made up as read
+void openIso(const char* filename)
+{
+	struct stat fileInfo;
 	
-	// put the track length info in the track list
-	CD.tl = (Track*) malloc(sizeof(Track));
+	CD.cd = fopen(filename, "rb");
+	if (CD.cd == 0)
+	{
+		SysPrintf("Error opening cd\n");
+		while(1);
+		return;
+	}
+	stat(filename, &fileInfo);
+	SysPrintf("size of CD in MB = %d\r\n", fileInfo.st_size/1048576);
 	
-	CD.tl[0].type = Mode2;
-	CD.tl[0].num = 1;
-	CD.tl[0].start[0] = 0;
-	CD.tl[0].start[1] = 0;
-	CD.tl[0].start[2] = 0;
-	CD.tl[0].end[2] = blocks % 75;
-	CD.tl[0].end[1] = ((blocks - CD.tl[0].end[2]) / 75) % 60;
-	CD.tl[0].end[0] = (((blocks - CD.tl[0].end[2]) / 75) - CD.tl[0].end[1]) / 60;
+	addFile(CD.cd, 0, fileInfo.st_size / 2048, 2048);
+	setSingleTrack(fileInfo.st_size / 2048);
+}
+
+// reads count raw sectors from a 2048 byte per sector file, by spacing the
+// user data out and giving every sector a Mode 2 Form 1 header
+static void isoRead(CDFile* file, unsigned char* buf, long sector, long count)
+{
+	static const unsigned char sync[12] =
+		{ 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00 };
+	long i, lba;
+	unsigned char* sec;
 	
-	CD.tl[0].start[1] += 2;
-	CD.tl[0].end[1] += 2;
+	memset(buf, 0, count * 2352);
+	rc = fseek(file->f, (sector - file->start) * 2048, SEEK_SET);
+	rc = fread(buf, 2048, count, file->f);
 	
-	normalizeTime(CD.tl[0].end);
+	// last first, the data only ever moves up
+	for (i = count - 1; i >= 0; i--)
+	{
+		sec = buf + i * 2352;
+		lba = sector + i + 150;
+		memmove(sec + 24, buf + i * 2048, 2048);
+		memcpy(sec, sync, 12);
+		sec[12] = intToBCD(lba / 75 / 60);
+		sec[13] = intToBCD(lba / 75 % 60);
+		sec[14] = intToBCD(lba % 75);
+		sec[15] = 0x02;
+		// subheader twice: file, channel, submode (data), coding
+		memset(sec + 16, 0, 8);
+		sec[18] = sec[22] = 0x08;
+		// no EDC/ECC, nothing downstream checks it
+		memset(sec + 24 + 2048, 0, 2352 - 24 - 2048);
+	}
+}
+
+// finds the file holding a disc sector, files are kept in disc order
+static CDFile* findFile(long sector)
+{
+	int lo = 0, hi = CD.numfiles - 1, mid;
 	
-	CD.numtracks = 1;
+	while (lo <= hi)
+	{
+		mid = (lo + hi) / 2;
+		if (sector < CD.files[mid].start)
+			hi = mid - 1;
+		else if (sector >= CD.files[mid].start + CD.files[mid].sectors)
+			lo = mid + 1;
+		else
+			return &CD.files[mid];
+	}
+	return NULL;
+}
+
+// fills a BUFFER_SIZE window with the raw sectors from image offset pos on,
+// from however many files they are spread over
+static void readWindow(unsigned char* buf, long pos)
+{
+	long sector = pos / 2352, n, count;
+	CDFile* file;
 	
-	//CD.bufferSize = 0;
-    CD.bufferPos = 0x7FFFFFFF;
-  //  CD.status = 0x00;
+	for (n = 0; n < BUFFER_SECTORS; n += count)
+	{
+		file = findFile(sector + n);
+		if (!file)
+		{
+			// a pregap or past the end of the disc
+			memset(buf + n * 2352, 0, 2352);
+			count = 1;
+			continue;
+		}
+		count = file->start + file->sectors - (sector + n);
+		if (count > BUFFER_SECTORS - n) count = BUFFER_SECTORS - n;
+		
+		if (file->sectorSize == 2048)
+			isoRead(file, buf + n * 2352, sector + n, count);
+		else
+		{
+			rc = fseek(file->f, (sector + n - file->start) * 2352, SEEK_SET);
+			rc = fread(buf + n * 2352, 2352, count, file->f);
+		}
+	}
+}
+
+// reads a little endian u32 from the index
+static unsigned long readLE32(const unsigned char* p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+// opens a compressed cd image and its chunk index
+void openZ(const char* filename)
+{
+	unsigned char header[12];
+	unsigned char* table;
+	char tablename[CHAR_LEN];
+	long i, sectors;
+	FILE* f;
+	
+	sprintf(tablename, "%s.table", filename);
+	f = fopen(tablename, "rb");
+	if(!f){ SysPrintf("Failed to open %s\n", tablename); while(1); }
+	
+	if(fread(header, 1, 12, f) != 12 || memcmp(header, "PSZ1", 4)){
+		SysPrintf("%s is not a compressed cd index\n", tablename);
+		fclose(f); while(1);
+	}
+	Z.chunkSectors = readLE32(header + 4);
+	sectors = readLE32(header + 8);
+	if(Z.chunkSectors < 1 || Z.chunkSectors > Z_CHUNK_SECTORS_MAX){
+		SysPrintf("Bad chunk size %d in %s\n", Z.chunkSectors, tablename);
+		fclose(f); while(1);
+	}
+	Z.chunks = (sectors + Z.chunkSectors - 1) / Z.chunkSectors;
+	
+	// Read the chunk offsets
+	table = malloc((Z.chunks + 1) * 4);
+	Z.offsets = malloc((Z.chunks + 1) * sizeof(unsigned long));
+	if(!table || !Z.offsets ||
+	   fread(table, 4, Z.chunks + 1, f) != Z.chunks + 1){
+		SysPrintf("Failed to read the index %s\n", tablename);
+		fclose(f); while(1);
+	}
+	fclose(f);
+	
+	Z.zbufSize = 0;
+	for(i = 0; i <= Z.chunks; i++){
+		Z.offsets[i] = readLE32(table + i * 4);
+		if(i && Z.offsets[i] - Z.offsets[i-1] > Z.zbufSize)
+			Z.zbufSize = Z.offsets[i] - Z.offsets[i-1];
+	}
+	free(table);
+	
+	// Buffers for one compressed chunk and the decompressed chunk LRU
+	Z.zbuf = malloc(Z.zbufSize);
+	for(i = 0; i < Z_CACHE_CHUNKS; i++){
+		Z.cache[i].chunk = -1;
+		Z.cache[i].used = 0;
+		Z.cache[i].data = malloc(Z.chunkSectors * 2352);
+		if(!Z.cache[i].data){ SysPrintf("Failed to malloc the chunk cache\n"); while(1); }
+	}
+	Z.useCount = 0;
+	
+	CD.cd = fopen(filename, "rb");
+	if(!CD.cd || !Z.zbuf){ SysPrintf("Failed to open %s for reading\n", filename); while(1); }
+	
+	SysPrintf("compressed CD: %d sectors in %d chunks\r\n", sectors, Z.chunks);
+	addFile(CD.cd, 0, sectors, 2352);
+	setSingleTrack(sectors);
+}
+
+// Sector cache: a LRU of BUFFER_SIZE windows, lCDCacheSize bytes in all,
+// so a movie stream and the level data it interleaves with both stay in
+// memory. With CD_READAHEAD a thread also fills the next window in the
+// direction the game is streaming, so readit only waits after a seek.
+enum { CACHE_EMPTY, CACHE_PENDING, CACHE_READY };
+
+typedef struct
+{
+	long pos;               // image offset of the window
+	volatile int state;     // only the thread moves PENDING to READY
+	unsigned long used;
+	unsigned char* data;
+} CacheWindow;
+
+static CacheWindow* cache = NULL;
+static int cacheWindows = 0;
+static unsigned long cacheUseCount;
+static long cacheLastPos;
+long lCDCacheSize = CD_CACHE_SIZE;
+unsigned long ulCDCacheHits = 0, ulCDCacheMisses = 0;
+
+#ifdef CD_READAHEAD
+#define RA_STACK_SIZE (8*1024)
+#define RA_PRIORITY 60
+
+static sem_t raRequest, raDone;
+static lwp_t raThread;
+static volatile int raQuit;
+static char raStack[RA_STACK_SIZE];
+#endif
+
+static void cacheRead(int i)
+{
+	lockFiles();
+	readWindow(cache[i].data, cache[i].pos);
+	unlockFiles();
+}
+
+static int cacheFind(long pos)
+{
+	int i;
+	
+	for(i = 0; i < cacheWindows; i++)
+		if(cache[i].state != CACHE_EMPTY && pos >= cache[i].pos && pos < cache[i].pos + BUFFER_SIZE)
+			return i;
+	return -1;
+}
+
+// least recently used window that isn't being read or handed out
+static int cacheVictim(void)
+{
+	int i, v = -1;
+	
+	for(i = 0; i < cacheWindows; i++){
+		if(cache[i].state == CACHE_PENDING || cache[i].data == CD.pBuffer ||
+		   cache[i].data == CD.pinned) continue;
+		if(v < 0 || cache[i].used < cache[v].used) v = i;
+	}
+	return v;
+}
+
+#ifdef CD_READAHEAD
+static void *raReadThread(void *arg)
+{
+	int i;
+	
+	while(1){
+		LWP_SemWait(raRequest);
+		if(raQuit) break;
+		
+		for(i = 0; i < cacheWindows; i++){
+			if(cache[i].state != CACHE_PENDING) continue;
+			cacheRead(i);
+			cache[i].state = CACHE_READY;
+			LWP_SemPost(raDone);
+		}
+	}
+	return NULL;
+}
+
+static void raPrefetch(long pos, int dir)
+{
+	// double speed streams twice as fast, stay two windows ahead
+	int n, i, ahead = (cdr.Mode & 0x80) ? 2 : 1;
+	long p;
+	
+	for(n = 1; n <= ahead; n++){
+		p = pos + dir * n * BUFFER_SIZE;
+		if(p < 0 || cacheFind(p) >= 0) continue;
+		if((i = cacheVictim()) < 0) return;
+		cache[i].pos = p;
+		cache[i].used = ++cacheUseCount;
+		cache[i].state = CACHE_PENDING;
+		LWP_SemPost(raRequest);
+	}
+}
+#endif
+
+static int cacheReadit(void)
+{
+	int i = cacheFind(CD.sector);
+	// a short step back is reading backwards, a long jump is another stream
+	int dir = (CD.sector < cacheLastPos &&
+	           CD.sector >= cacheLastPos - 2*BUFFER_SIZE) ? -1 : 1;
+	
+	if(i >= 0){
+		ulCDCacheHits++;
+#ifdef CD_READAHEAD
+		// still on its way in, but the card is already seeking for us
+		while(cache[i].state == CACHE_PENDING) LWP_SemWait(raDone);
+#endif
+	} else {
+		ulCDCacheMisses++;
+		if((i = cacheVictim()) < 0) return 0;
+		cache[i].pos = CD.sector;
+		cacheRead(i);
+		cache[i].state = CACHE_READY;
+	}
+	cache[i].used = ++cacheUseCount;
+	cacheLastPos = CD.sector;
+	
+	CD.pBuffer = cache[i].data;
+	CD.bufferPos = cache[i].pos;
+	CD.bufferSize = BUFFER_SIZE;
+#ifdef CD_READAHEAD
+	raPrefetch(CD.bufferPos, dir);
+#endif
+	return 1;
+}
+
+static void cacheClose(void)
+{
+	int i;
+	
+	if(!cache) return;
+#ifdef CD_READAHEAD
+	raQuit = 1;
+	LWP_SemPost(raRequest);
+	LWP_JoinThread(raThread, NULL);
+	LWP_SemDestroy(raRequest);
+	LWP_SemDestroy(raDone);
+#endif
+	for(i = 0; i < cacheWindows; i++)
+		free(cache[i].data);
+	free(cache);
+	cache = NULL;
+	cacheWindows = 0;
+	SysPrintf("CD cache: %d hits, %d misses\r\n", ulCDCacheHits, ulCDCacheMisses);
+}
+
+static void cacheOpen(void)
+{
+	int i, windows = lCDCacheSize / BUFFER_SIZE;
+	
+	cacheClose();
+	// the current window and two being read ahead need somewhere to go
+	if(windows < 4) windows = 4;
+	cache = malloc(windows * sizeof(CacheWindow));
+	if(!cache) return;
+	for(i = 0; i < windows; i++){
+		cache[i].data = memalign(32, BUFFER_SIZE);
+		cache[i].pos = -1;
+		cache[i].state = CACHE_EMPTY;
+		cache[i].used = 0;
+		if(!cache[i].data) break;
+	}
+	if(i < 4){
+		// not enough memory, fall back to the single CD.buffer window
+		while(--i >= 0) free(cache[i].data);
+		free(cache);
+		cache = NULL;
+		return;
+	}
+	cacheWindows = i;
+	cacheUseCount = 0;
+	cacheLastPos = -1;
+	ulCDCacheHits = ulCDCacheMisses = 0;
+#ifdef CD_READAHEAD
+	LWP_SemInit(&raRequest, 0, cacheWindows + 1);
+	LWP_SemInit(&raDone, 0, cacheWindows);
+	raQuit = 0;
+	LWP_CreateThread(&raThread, raReadThread, NULL, raStack, RA_STACK_SIZE, RA_PRIORITY);
+#endif
+}
+
+// CD audio: CDR_play starts a thread streaming the sectors into the SPU.
+// The SPU only takes a few sectors ahead, so it is this thread that waits
+// for them to be played, never the emulation for the card.
+#ifdef CD_CDDA
+#define CDDA_STACK_SIZE (8*1024)
+#define CDDA_PRIORITY 60
+#define CDDA_WAIT 5000          // us before offering the SPU a sector again
+
+static lwp_t cddaThread;
+static sem_t cddaWake;
+static int cddaRunning = 0;
+static volatile int cddaPlaying, cddaQuit, cddaSeek;
+static volatile long cddaStart;
+static volatile long cddaPos;           // the sector going to the SPU
+static unsigned char cddaBuffer[BUFFER_SIZE];
+static char cddaStack[CDDA_STACK_SIZE];
+
+static void *cddaStream(void *arg)
+{
+	long sector = 0, end;
+	int seek = -1, n;
+	
+	while(!cddaQuit){
+		if(!cddaPlaying){
+			LWP_SemWait(cddaWake);
+			continue;
+		}
+		if(seek != cddaSeek){
+			seek = cddaSeek;
+			sector = cddaStart;
+		}
+		// play goes on until the end of the disc
+		end = CD.files[CD.numfiles-1].start + CD.files[CD.numfiles-1].sectors;
+		if(sector >= end){
+			cddaPlaying = 0;
+			continue;
+		}
+		
+		lockFiles();
+		readWindow(cddaBuffer, sector * 2352);
+		unlockFiles();
+		
+		for(n = 0; n < BUFFER_SECTORS && sector + n < end &&
+		           cddaPlaying && seek == cddaSeek && !cddaQuit; n++){
+			cddaPos = sector + n;
+			while(SPU_playCDDAchannel((short*)(cddaBuffer + n * 2352), 2352) &&
+			      cddaPlaying && seek == cddaSeek && !cddaQuit)
+				usleep(CDDA_WAIT);
+		}
+		sector += n;
+	}
+	return NULL;
+}
+
+static void cddaClose(void)
+{
+	if(!cddaRunning) return;
+	cddaQuit = 1;
+	cddaPlaying = 0;
+	LWP_SemPost(cddaWake);
+	LWP_JoinThread(cddaThread, NULL);
+	LWP_SemDestroy(cddaWake);
+	cddaRunning = 0;
+}
+#endif
+
+static void closeZ(void)
+{
+	int i;
+	
+	for(i = 0; i < Z_CACHE_CHUNKS; i++){
+		free(Z.cache[i].data);
+		Z.cache[i].data = NULL;
+	}
+	free(Z.offsets); Z.offsets = NULL;
+	free(Z.zbuf); Z.zbuf = NULL;
+}
+
+// decompresses a chunk to dst through zbuf, returns 0 on errors
+static int inflateZChunk(long chunk, unsigned char* dst, unsigned char* zbuf)
+{
+	unsigned long size = Z.offsets[chunk+1] - Z.offsets[chunk];
+	uLongf length = Z.chunkSectors * 2352;
+	int ok;
+	
+	lockFiles();
+	fseek(CD.cd, Z.offsets[chunk], SEEK_SET);
+	ok = fread(zbuf, 1, size, CD.cd) == size;
+	unlockFiles();
+	if(!ok || uncompress(dst, &length, zbuf, size) != Z_OK){
+		SysPrintf("Error decompressing chunk %d\n", chunk);
+		return 0;
+	}
+	return 1;
+}
+
+// returns the decompressed chunk, from the LRU if we can, NULL on errors
+static unsigned char* getZChunk(long chunk)
+{
+	int i, lru = -1;
+	
+	for(i = 0; i < Z_CACHE_CHUNKS; i++){
+		if(Z.cache[i].chunk == chunk){
+			Z.cache[i].used = ++Z.useCount;
+			return Z.cache[i].data;
+		}
+		// the chunk of the sector handed out stays
+		if(Z.cache[i].data == CD.pinned) continue;
+		if(lru < 0 || Z.cache[i].used < Z.cache[lru].used) lru = i;
+	}
+	
+	// Not cached: decompress it over the least recently used one
+	if(!inflateZChunk(chunk, Z.cache[lru].data, Z.zbuf)){
+		Z.cache[lru].chunk = -1; // try again next time
+		return NULL;
+	}
+	
+	Z.cache[lru].chunk = chunk;
+	Z.cache[lru].used = ++Z.useCount;
+	return Z.cache[lru].data;
 }
 
 void addBinTrackInfo()
@@ -132,6 +676,127 @@ void addBinTrackInfo()
 
 }
 
+// Preload: with lCDPreload set the whole image is read (or decompressed)
+// into memory when it is opened, on a thread where there are threads.
+// readit serves every sector that is in already from there. The Wii
+// keeps it in MEM2, which holds images up to ~52MB; the GameCube only
+// has its 24MB, so there only images up to PRELOAD_MAX are preloaded.
+// Larger images are read as usual.
+#ifndef HW_RVL
+#define PRELOAD_MAX (8*1024*1024)
+#endif
+long lCDPreload = 0;
+volatile long lCDPreloaded = 0;
+long lCDPreloadTotal = 0;
+static unsigned char* preload = NULL;
+static unsigned long preloadSize;
+
+#ifdef CD_THREADED
+#define PRELOAD_STACK_SIZE (8*1024)
+#define PRELOAD_PRIORITY 50     // below the emulation, it has all the time
+static lwp_t preloadThread;
+static char preloadStack[PRELOAD_STACK_SIZE];
+#endif
+static volatile int preloadQuit;
+
+static void *preloadImage(void *arg)
+{
+	long sector, n, tenth = 0;
+	unsigned char* zbuf = NULL;
+	
+	// the chunks are the steps of a compressed image, windows otherwise
+	if(CD.type == IndexZ) zbuf = malloc(Z.zbufSize);
+	n = CD.type == IndexZ ? Z.chunkSectors : BUFFER_SECTORS;
+	
+	for(sector = 0; sector < lCDPreloadTotal && !preloadQuit; sector += n){
+		if(CD.type == IndexZ){
+			// a broken chunk ends the preload, readit reports it
+			if(!zbuf || !inflateZChunk(sector / n, preload + sector * 2352, zbuf))
+				break;
+		} else {
+			lockFiles();
+			readWindow(preload + sector * 2352, sector * 2352);
+			unlockFiles();
+		}
+		lCDPreloaded = sector + n < lCDPreloadTotal ? sector + n : lCDPreloadTotal;
+		
+		if(lCDPreloaded * 10 / lCDPreloadTotal > tenth){
+			tenth = lCDPreloaded * 10 / lCDPreloadTotal;
+			SysPrintf("Preloading CD: %d%%\r\n", tenth * 10);
+		}
+	}
+	free(zbuf);
+	return NULL;
+}
+
+static void preloadClose(void)
+{
+	if(!preload) return;
+#ifdef CD_THREADED
+	preloadQuit = 1;
+	LWP_JoinThread(preloadThread, NULL);
+#endif
+#ifndef HW_RVL
+	free(preload);
+#endif
+	preload = NULL;
+	lCDPreloaded = 0;
+}
+
+static void preloadOpen(void)
+{
+	lCDPreloadTotal = CD.files[CD.numfiles-1].start + CD.files[CD.numfiles-1].sectors;
+	lCDPreloaded = 0;
+	// room to write whole windows and chunks past the end
+	preloadSize = lCDPreloadTotal * 2352 + BUFFER_SIZE;
+	
+#ifdef HW_RVL
+	if(preloadSize <= CDPRELOAD_SIZE) preload = (unsigned char*)CDPRELOAD_LO;
+#else
+	if(preloadSize <= PRELOAD_MAX) preload = memalign(32, preloadSize);
+#endif
+	if(!preload){
+		SysPrintf("The CD is too big to preload (%dMB)\r\n", preloadSize/1048576);
+		return;
+	}
+	
+	preloadQuit = 0;
+#ifdef CD_THREADED
+	LWP_CreateThread(&preloadThread, preloadImage, NULL, preloadStack, PRELOAD_STACK_SIZE, PRELOAD_PRIORITY);
+#else
+	preloadImage(NULL);
+#endif
+}
+
+// opens a FILE of a cue sheet, relative to the cue's directory or absolute
+static FILE* openCueFile(const char* bin_filename, long* size)
+{
+	// Create a string with the bin filename based on the cue's path
+	char relative[CHAR_LEN + 80];
+	const char* path = relative;
+	sprintf(relative, "%s/%s", CDConfiguration.dn, bin_filename);
+	// Determine relative vs absolute path and get the stat
+	struct stat binInfo;
+	if( stat(relative, &binInfo) ){
+		SysPrintf("Failed to open %s\n", relative);
+		// The relative path failed, try absolute
+		if( stat(bin_filename, &binInfo) ){
+			SysPrintf("Failed to open %s\n", bin_filename);
+			while(1);
+		}
+		path = bin_filename;
+	}
+	*size = binInfo.st_size;
+	
+	// Actually open the data for reading
+	FILE* f = fopen(path, "rb");
+	if(!f){
+		SysPrintf("Failed to open %s for reading\n", path);
+		while(1);
+	}
+	return f;
+}
+
 // Given the name of a cue sheet, parse its track info
 void openCue(const char* filename)
 {
@@ -158,10 +823,16 @@ void openCue(const char* filename)
 	CD.numtracks = 1;
 	int num_tracks_seen = 0;
 	char bin_filename[80];
+	// Every FILE becomes an entry in CD.files, placed after the last one
+	CDFile* file = NULL;
+	long file_size = 0;
+	int file_tracks = 0;
 	// Get the first token
 	char* token = strtok(cueText, " \t\n\r");
 	// nxttok() is just shorthand for using strtok to get the next
 	#define nxttok() strtok(NULL, " \t\n\r")
+	// Once a file's tracks are typed we know how many sectors it holds
+	#define endfile() if(file) file->sectors = file_size / file->sectorSize
 	// Read and parse the cue sheet
 	while(token){
 		// Check against keywords we're intested in and handle if necessary
@@ -183,30 +854,49 @@ void openCue(const char* filename)
 			// FIXME: Byteswap based on BINARY vs MOTOROLA?
 			/* file_type = */ nxttok();
 			
+			endfile();
+			FILE* f = openCueFile(bin_filename, &file_size);
+			addFile(f, file ? file->start + file->sectors : 0, 0, 2352);
+			file = &CD.files[CD.numfiles-1];
+			file_tracks = 0;
+			
 		} else if( !strcmp(token, "TRACK") ){
 			if(++num_tracks_seen > CD.numtracks)
 				CD.tl = realloc(CD.tl, ++CD.numtracks * sizeof(Track));
-			/* track_num = */ nxttok();
+			CD.tl[CD.numtracks-1].num = atoi(nxttok());
 			
 			char* track_type = nxttok();
 			if( !strcmp(track_type, "AUDIO") )
 				CD.tl[CD.numtracks-1].type = Audio;
-			else if( !strcmp(track_type, "MODE1/2352") )
+			else if( !strncmp(track_type, "MODE1/", 6) )
 				CD.tl[CD.numtracks-1].type = Mode1;
-			else if( !strcmp(track_type, "MODE2/2352") )
+			else if( !strncmp(track_type, "MODE2/", 6) )
 				CD.tl[CD.numtracks-1].type = Mode2;
 			else
 				CD.tl[CD.numtracks-1].type = unknown;
+			// Files of user data only get their headers made up as read
+			if(file && !file_tracks++ && strstr(track_type, "/2048"))
+				file->sectorSize = 2048;
+			
+		} else if( !strcmp(token, "PREGAP") ){
+			char* gap = nxttok(); // mm:ss:ff format, not stored in the file
+			gap[2] = gap[5] = 0;
+			// Only a gap before a file's first track just moves the file
+			if(file && file_tracks == 1)
+				file->start += (atoi(gap) * 60 + atoi(gap+3)) * 75 + atoi(gap+6);
+			else
+				SysPrintf("Ignoring PREGAP inside a file\n");
 			
 		} else if( !strcmp(token, "INDEX") ){
-			nxttok(); // Read and discard the "01"
+			char* index = nxttok(); // Only "01" is where the track starts
 			char* track_start = nxttok(); // mm:ss:ff format
+			if(strcmp(index, "01") || !file){ token = nxttok(); continue; }
 			SysPrintf("Track beginning at %s\n", track_start);
-			track_start[2] = track_start[4] = 0; // Null out the ':'
-			// Parse the start index to the start value
-			CD.tl[CD.numtracks-1].start[0] = atoi(track_start+0);
-			CD.tl[CD.numtracks-1].start[1] = atoi(track_start+3);
-			CD.tl[CD.numtracks-1].start[2] = atoi(track_start+6);
+			track_start[2] = track_start[5] = 0; // Null out the ':'
+			// Parse the start index within the file to the disc start
+			sectorsToTime(file->start + 150 +
+			              (atoi(track_start+0) * 60 + atoi(track_start+3)) * 75 +
+			              atoi(track_start+6), CD.tl[CD.numtracks-1].start);
 			// If we've already seen another track, this is its end
 			if(CD.numtracks > 1){
 				CD.tl[CD.numtracks-2].end[0] = CD.tl[CD.numtracks-1].start[0];
@@ -218,38 +908,17 @@ void openCue(const char* filename)
 		// Get the next token
 		token = nxttok();
 	}
+	endfile();
+	#undef endfile
 	#undef nxttok
 	// Free the buffer
 	free(cueText);
 	
-	// Create a string with the bin filename based on the cue's path
-	char relative[80];
-	sprintf(relative, "%s/%s", CDConfiguration.dn, bin_filename);
-	// Determine relative vs absolute path and get the stat
-	struct stat binInfo;
-	if( stat(relative, &binInfo) ){
-		SysPrintf("Failed to open %s\n", relative);
-		// The relative path failed, try absolute
-		if( stat(bin_filename, &binInfo) ){
-			SysPrintf("Failed to open %s\n", bin_filename);
-			while(1);
-		}
-	} else strcpy(bin_filename, relative);
-	// Fill out the last track's end based on size
-	unsigned int blocks = binInfo.st_size / 2352;
-	CD.tl[CD.numtracks-1].end[2] = blocks % 75;
-	CD.tl[CD.numtracks-1].end[1] = ((blocks - CD.tl[CD.numtracks-1].end[2]) / 75) % 60;
-	CD.tl[CD.numtracks-1].end[0] = (((blocks - CD.tl[CD.numtracks-1].end[2]) / 75)
-	                             - CD.tl[CD.numtracks-1].end[1]) / 60;
-	normalizeTime(CD.tl[CD.numtracks-1].end);
+	if(!file){ SysPrintf("No FILE in %s\n", filename); while(1); }
+	CD.cd = CD.files[0].f;
 	
-	// Actually open the data for reading
-	// FIXME: Make sure I'm not leaving an old cd open
-	CD.cd = fopen(bin_filename, "rb");
-	if(!CD.cd){
-		SysPrintf("Failed to open %s for reading\n", bin_filename);
-		while(1);
-	}
+	// Fill out the last track's end from where the last file ends
+	sectorsToTime(file->start + file->sectors + 150, CD.tl[CD.numtracks-1].end);
 }
 
 // new file types should be added here and in the CDOpen function
@@ -261,12 +930,27 @@ void newCD(const char * filename)
 	if( !strcmp(ext, ".cue") ){ // FIXME: Play nicely with case
 		CD.type = Cue;
 		openCue(filename);
+	} else if( !strcmp(ext + 2, ".Z") ){
+		CD.type = IndexZ;
+		openZ(filename);
+		addBinTrackInfo();
+	} else if( !strcmp(ext, ".iso") ){
+		CD.type = Iso;
+		openIso(filename);
+		addBinTrackInfo();
 	} else {
 		CD.type = Bin;
 		openBin(filename);
 		addBinTrackInfo();
 	}
 	
+#ifdef CD_THREADED
+	LWP_SemInit(&cdFile, 1, 1);
+#endif
+	if (CD.type != IndexZ) cacheOpen();
+	if (lCDPreload) preloadOpen();
+	
+	CD.pinned = NULL;
 	CD.bufferPos = 0x7FFFFFFF;
 	seekSector(0,2,0);
 }
@@ -275,7 +959,7 @@ void newCD(const char * filename)
 // return the sector address - the buffer address + 12 bytes for offset.
 unsigned char* getSector(int subchannel)
 {
-	return CD.buffer + (CD.sector - CD.bufferPos) + ((subchannel) ? 0 : 12);
+	return CD.pBuffer + (CD.sector - CD.bufferPos) + ((subchannel) ? 0 : 12);
 }
 
 // returns the number of tracks
@@ -287,61 +971,71 @@ char getNumTracks()
 	return CD.numtracks;
 }
 
-void readit(const unsigned char m, const unsigned char s, const unsigned char f)
+// returns -1 when the sectors can't be read, nothing is cached then
+int readit(const unsigned char m, const unsigned char s, const unsigned char f)
 {
+	// preloaded: everything that is in already is the cache
+	if (preload && CD.sector >= 0 && CD.sector / 2352 < lCDPreloaded)
+	{
+		CD.pBuffer = preload;
+		CD.bufferPos = 0;
+		CD.bufferSize = lCDPreloaded * 2352;
+		return 0;
+	}
 	
-	// fakie ISO support.  iso is just cd-xa data without the ecc and header.
-	// read in the same number of sectors then space it out to look like cd-xa
-	/* if (CD.type == Iso)
+	// compressed image: the chunk holding the sector is our cache
+	if (CD.type == IndexZ)
 	{
-		unsigned char temptime[3];
-		long tempsector = (( (m * 60) + (s - 2)) * 75 + f) * 2048;
-		fs_seek(CD.cd, tempsector, SEEK_SET);
-		fs_read(CD.buffer, sizeof(unsigned char), 2048*BUFFER_SECTORS, CD.cd);
+		long chunk = (CD.sector / 2352) / Z.chunkSectors;
 		
-		// spacing out the data here...
-		for(tempsector = BUFFER_SECTORS - 1; tempsector >= 0; tempsector--)
+		if (CD.sector < 0 || chunk >= Z.chunks)
 		{
-			memcpy(&CD.buffer[tempsector*2352 + 24],&CD.buffer[tempsector*2048], 2048);
-			
-			// two things - add the m/s/f flags in case anyone is looking
-			// and change the xa mode to 1
-			temptime[0] = m;
-			temptime[1] = s;
-			temptime[2] = f + (unsigned char)tempsector;
-			
-			normalizeTime(temptime);
-			CD.buffer[tempsector*2352+12] = intToBCD(temptime[0]);
-			CD.buffer[tempsector*2352+12+1] = intToBCD(temptime[1]);
-			CD.buffer[tempsector*2352+12+2] = intToBCD(temptime[2]);
-			CD.buffer[tempsector*2352+12+3] = 0x01;
+			// outside of the image, give back empty sectors
+			memset(CD.buffer, 0, BUFFER_SIZE);
+			CD.pBuffer = CD.buffer;
+			CD.bufferPos = CD.sector;
+			CD.bufferSize = 2352;
+			return 0;
 		}
+		CD.pBuffer = getZChunk(chunk);
+		if (CD.pBuffer == NULL)
+		{
+			CD.bufferPos = 0x7FFFFFFF;
+			CD.bufferSize = 0;
+			return -1;
+		}
+		CD.bufferPos = chunk * Z.chunkSectors * 2352;
+		CD.bufferSize = Z.chunkSectors * 2352;
+		return 0;
 	}
-	else */
-	{
-		rc = fseek(CD.cd, CD.sector, SEEK_SET);
-		rc = fread(CD.buffer, BUFFER_SIZE, 1, CD.cd);
-	}
 	
+	if (cache && CD.sector >= 0 && cacheReadit())
+		return 0;
+	
+	readWindow(CD.buffer, CD.sector);
+	
+	CD.pBuffer = CD.buffer;
 	CD.bufferPos = CD.sector;
+	CD.bufferSize = BUFFER_SIZE;
+	return 0;
 }
 
 
-void seekSector(const unsigned char m, const unsigned char s, const unsigned char f)
+int seekSector(const unsigned char m, const unsigned char s, const unsigned char f)
 {
 	// calc byte to search for
 	int sector = (( (m * 60) + (s - 2)) * 75 + f);
 	CD.sector = sector * 2352;
 	
 	// is it cached?
-	if ((CD.sector >= CD.bufferPos) && (CD.sector < (CD.bufferPos + BUFFER_SIZE)) ) 
+	if ((CD.sector >= CD.bufferPos) && (CD.sector < (CD.bufferPos + CD.bufferSize)) ) 
 	{
-	    return;
+	    return 0;
 	}
 	// not cached - read a few blocks into the cache
 	else
 	{
-		readit(m,s,f);
+		return readit(m,s,f);
 	}
 }
 
@@ -387,8 +1081,17 @@ long CDR__shutdown(void) {
 
 long CDR__close(void) {
 	SysPrintf("start CDR_close()\r\n");
-	fclose(CD.cd);
+	cacheClose();
+#ifdef CD_CDDA
+	cddaClose();
+#endif
+	preloadClose();
+#ifdef CD_THREADED
+	LWP_SemDestroy(cdFile);
+#endif
+	closeFiles();
 	free(CD.tl);
+	if (CD.type == IndexZ) closeZ();
 	SysPrintf("end CDR_close()\r\n");
 	return 0;
 }
@@ -411,19 +1114,74 @@ long CDR__getTD(unsigned char track, unsigned char *buffer) {
 
 /* called when the psx requests a read */
 long CDR__readTrack(unsigned char *time) {
-	if (CD.cd != 0)
-		seekSector(BCDToInt(time[0]), BCDToInt(time[1]), BCDToInt(time[2]));
+	if (CD.cd != 0 &&
+	    seekSector(BCDToInt(time[0]), BCDToInt(time[1]), BCDToInt(time[2])) == -1)
+		return PSE_CDR_ERR_FAILURE;
 	return PSE_CDR_ERR_SUCCESS;
 }
 
-/* called after the read should be finished, and the data is needed */
+/* starts cd audio at a (non-BCD) time, as left by CdlSetloc */
+long CDR__play(unsigned char *time) {
+#ifdef CD_CDDA
+	if (CD.cd == 0 || CD.type == IndexZ)
+		return 0;
+	if (!cddaRunning) {
+		LWP_SemInit(&cddaWake, 0, 1);
+		cddaQuit = cddaPlaying = 0;
+		cddaRunning = 1;
+		LWP_CreateThread(&cddaThread, cddaStream, NULL, cddaStack, CDDA_STACK_SIZE, CDDA_PRIORITY);
+	}
+	cddaStart = ((time[0] * 60) + time[1]) * 75 + time[2] - 150;
+	cddaPos = cddaStart;
+	cddaSeek++;
+	cddaPlaying = 1;
+	LWP_SemPost(cddaWake);
+#endif
+	return 0;
+}
+
+long CDR__stop(void) {
+#ifdef CD_CDDA
+	cddaPlaying = 0;
+#endif
+	return 0;
+}
+
+/* the time cd audio is at, like CDR__play takes it; -1 when it isn't playing */
+long CDR__getPlayPos(unsigned char *time) {
+#ifdef CD_CDDA
+	long sector = cddaPos + 150;
+
+	if (!cddaPlaying)
+		return -1;
+	time[0] = sector / (60 * 75);
+	time[1] = (sector / 75) % 60;
+	time[2] = sector % 75;
+	return 0;
+#else
+	return -1;
+#endif
+}
+
+/* called after the read should be finished, and the data is needed.
+   The sector is read in place, out of the window, chunk or preload it
+   is in, and stays there until the next call, whatever is read since;
+   only CD.buffer, which every uncached read reuses, is copied. */
 unsigned char *CDR__getBuffer(void) {
-	if (CD.cd == 0)
+	if (CD.cd == 0 || CD.pBuffer == NULL)
 		return NULL;
+	if (CD.pBuffer == CD.buffer) {
+		CD.pinned = NULL;
+		memcpy(CD.sectorCopy, getSector(1), 2352);
+		return CD.sectorCopy + 12;
+	}
+	CD.pinned = CD.pBuffer;
     return getSector(0);
 }
 
 unsigned char *CDR__getBufferSub(void) {
+	if (CD.pBuffer == NULL)
+		return NULL;
     return getSector(1);
 }
 
@@ -431,6 +1189,4 @@ unsigned char *CDR__getBufferSub(void) {
 long (CALLBACK* CDRconfigure)(void);
 long (CALLBACK* CDRtest)(void);
 void (CALLBACK* CDRabout)(void);
-long (CALLBACK* CDRplay)(unsigned char *);
-long (CALLBACK* CDRstop)(void);
 */
@@ -8,9 +8,22 @@
 
 // 2352 is a sector size, so cache is 50 sectors
 #define BUFFER_SECTORS 32
-#define BUFFER_SIZE BUFFER_SECTORS*2352
+#define BUFFER_SIZE (BUFFER_SECTORS*2352)
 #define BZIP_BUFFER_SECTORS 10
 
+// Compressed images (IndexZ): "game.Z" holds the raw 2352 byte sectors
+// in chunks of Z_CHUNK_SECTORS, each chunk zlib compressed on its own.
+// "game.Z.table" is the index: a 12 byte header ("PSZ1", then the chunk
+// sectors and the total number of sectors as little endian u32s) and then
+// one little endian u32 file offset per chunk plus one for the end of the
+// last chunk. A few decompressed chunks are kept in a LRU. Gamecube/tools/
+// mkz.c makes both files from a raw image.
+#define Z_CHUNK_SECTORS_MAX BUFFER_SECTORS
+#define Z_CACHE_CHUNKS 4
+
+// raw images are cached as a LRU of BUFFER_SIZE windows, ~1.2MB by default
+#define CD_CACHE_SIZE (16*BUFFER_SIZE)
+
 //  74 minutes * 60 sex/min * 75 frames/sec * 96 bytes needed per frame
 #define TOTAL_CD_LENGTH 74*60*75
 #define BYTES_PER_SUBCHANNEL_FRAME 96
@@ -32,7 +45,7 @@ enum TrackType
 
 enum CDType
 {
-   unk, Bin, Cue, Rar, IndexBZ, IndexZ, SBI, M3S
+   unk, Bin, Cue, Rar, IndexBZ, IndexZ, SBI, M3S, Iso
 };
 
 typedef struct
@@ -43,29 +56,54 @@ typedef struct
    unsigned char end[3];
 } Track;
 
+// an image file and where its sectors sit on the disc
+typedef struct
+{
+   FILE* f;
+   long start;          // first disc sector in the file, 0 is 00:02:00
+   long sectors;
+   int sectorSize;      // 2352 raw or 2048 user data only
+} CDFile;
+
 struct
 {   
-   FILE* cd;
+   FILE* cd;            // the first file
+   CDFile* files;       // in disc order
+   int numfiles;
    FILE* cdda;
    int numtracks;
    long bufferPos;
    long sector;
    Track* tl;
    unsigned char buffer[BUFFER_SIZE];
+   unsigned char* pBuffer;   // the cached sectors: CD.buffer or a Z chunk
+   long bufferSize;
+   unsigned char* pinned;    // holds the sector CDR_getBuffer handed out
+   unsigned char sectorCopy[2352];
    enum CDType type;
 } CD;
 
 void CDDAclose(void);
 
+// sector cache size in bytes (set before CDR_open) and its window lookups
+extern long lCDCacheSize;
+extern unsigned long ulCDCacheHits, ulCDCacheMisses;
+// read the whole image into memory when it's opened (set before CDR_open)
+// and how far that is, in sectors; up to ~52MB on Wii, 8MB on GameCube
+extern long lCDPreload;
+extern volatile long lCDPreloaded;
+extern long lCDPreloadTotal;
+
 // function headers for cdreader.c
 void openCue(const char* filename);
 void openBin(const char* filename);
 void openIso(const char* filename);
+void openZ(const char* filename);
 char getNumTracks();
-void seekSector(const unsigned char m, const unsigned char s, const unsigned char f);
+int seekSector(const unsigned char m, const unsigned char s, const unsigned char f);
 unsigned char* getSector();
 void newCD(const char * filename);
-void readit(const unsigned char m, const unsigned char s, const unsigned char f);
+int readit(const unsigned char m, const unsigned char s, const unsigned char f);
 
 
 // subtracts two times in integer format (non-BCD) ->  l - r = a
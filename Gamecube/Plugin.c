@@ -258,6 +258,7 @@ int OpenPlugins() {
 void ClosePlugins() {
 	int ret;
 
+	// CDR first: joining its CDDA thread stops it feeding the SPU we free next
 	ret = CDR_close();
 	if (ret < 0) { SysPrintf("Error Closing CDR Plugin\n"); return; }
 	ret = SPU_close();
@@ -23,6 +23,7 @@
 #define EXT
 #include "PsxCommon.h"
 #include "GamecubePlugins.h"
+#include "Movie.h"
 #define CheckErr(func) \
     err = SysLibError(); \
     if (err != NULL) { SysPrintf("Error loading %s: %s\n", func, err); return -1; }
@@ -136,6 +137,8 @@ void CALLBACK GPU__keypressed(int key) {}
 long CALLBACK GPU__getScreenPic(unsigned char *pMem) { return -1; }
 long CALLBACK GPU__showScreenPic(unsigned char *pMem) { return -1; }
 void CALLBACK GPU__clearDynarec(void (CALLBACK *callback)(void)) { }
+void CALLBACK GPU__setOutput(int on) { }
+void CALLBACK GPU__setDeterministic(int mode) { }
 
 #define LoadGpuSym1(dest, name) \
 	LoadSym(GPU_##dest, GPU##dest, name, 1);
@@ -176,6 +179,8 @@ int LoadGPUplugin(char *GPUdll) {
 	LoadGpuSym0(getScreenPic, "GPUgetScreenPic");
 	LoadGpuSym0(showScreenPic, "GPUshowScreenPic");
 	LoadGpuSym0(clearDynarec, "GPUclearDynarec");
+	LoadGpuSym0(setOutput, "GPUsetOutput");
+	LoadGpuSym0(setDeterministic, "GPUsetDeterministic");
 	LoadGpuSym0(configure, "GPUconfigure");
 	LoadGpuSym0(test, "GPUtest");
 	LoadGpuSym0(about, "GPUabout");
@@ -184,8 +189,6 @@ int LoadGPUplugin(char *GPUdll) {
 }
 
 void *hCDRDriver;
-long CALLBACK CDR__play(unsigned char *sector) { return 0; }
-long CALLBACK CDR__stop(void) { return 0; }
 
 long CALLBACK CDR__getStatus(struct CdrStat *stat) {
     if (cdOpenCase) stat->Status = 0x10;
@@ -234,6 +237,7 @@ int LoadCDRplugin(char *CDRdll) {
 	LoadCdrSym0(configure, "CDRconfigure");
 	LoadCdrSym0(test, "CDRtest");
 	LoadCdrSym0(about, "CDRabout");
+	LoadCdrSym0(getPlayPos, "CDRgetPlayPos");
 
 	return 0;
 }
@@ -243,6 +247,10 @@ void *hSPUDriver;
 long CALLBACK SPU__configure(void) { return 0; }
 void CALLBACK SPU__about(void) {}
 long CALLBACK SPU__test(void) { return 0; }
+// no room: the cd plugin waits, there is nobody to play it
+long CALLBACK SPU__playCDDAchannel(short *pcm, int nbytes) { return -1; }
+void CALLBACK SPU__setOutput(int on) { }
+void CALLBACK SPU__setDeterministic(int on) { }
 
 #if 0 //these are in the null library
 unsigned short regArea[10000];
@@ -477,6 +485,9 @@ int LoadSPUplugin(char *SPUdll) {
 	LoadSpuSym1(playADPCMchannel, "SPUplayADPCMchannel");
 	LoadSpuSym1(freeze, "SPUfreeze");
 	LoadSpuSym1(async, "SPUasync");
+	LoadSpuSym0(playCDDAchannel, "SPUplayCDDAchannel");
+	LoadSpuSym0(setOutput, "SPUsetOutput");
+	LoadSpuSym0(setDeterministic, "SPUsetDeterministic");
 	LoadSpuSym1(registerCallback, "SPUregisterCallback");
 	//LoadSpuSym1(registerCDDAVolume, "SPUregisterCDDAVolume");
 
@@ -567,6 +578,7 @@ unsigned char CALLBACK PAD1__startPoll(int pad) {
 	PadDataS padd;
 
 	PAD1_readPort1(&padd);
+	MoviePad(1, &padd);
 
 	return _PADstartPoll(&padd);
 }
@@ -621,6 +633,7 @@ unsigned char CALLBACK PAD2__startPoll(int pad) {
 	PadDataS padd;
 
 	PAD2_readPort2(&padd);
+	MoviePad(2, &padd);
 	
 	return _PADstartPoll(&padd);
 }
@@ -0,0 +1,104 @@
+/*  mkz - compresses a raw cd image for the GameCube cd plugin
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * A host tool, it is not part of the dol. Build and run it with
+ *
+ *   gcc -O2 -o mkz mkz.c -lz
+ *   ./mkz game.bin game.Z [chunk sectors]
+ *
+ * game.bin has to be a single track raw image (2352 byte sectors).
+ * It writes game.Z and game.Z.table in the format PlugCD.h describes,
+ * copy both next to each other to the card.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#define SECTOR_SIZE 2352
+#define CHUNK_SECTORS_MAX 32	// Z_CHUNK_SECTORS_MAX in PlugCD.h
+
+static void writeLE32(FILE* f, unsigned long v)
+{
+	unsigned char b[4];
+
+	b[0] = v; b[1] = v >> 8; b[2] = v >> 16; b[3] = v >> 24;
+	fwrite(b, 1, 4, f);
+}
+
+int main(int argc, char *argv[])
+{
+	FILE *in, *out, *table;
+	char tablename[1024];
+	unsigned char *raw, *z;
+	unsigned long sectors, chunks, i, offset = 0;
+	long chunkSectors = 16, size;
+	uLongf zsize;
+
+	if (argc < 3) {
+		fprintf(stderr, "usage: %s image.bin image.Z [chunk sectors]\n", argv[0]);
+		return 1;
+	}
+	if (argc > 3) chunkSectors = atol(argv[3]);
+	if (chunkSectors < 1 || chunkSectors > CHUNK_SECTORS_MAX) {
+		fprintf(stderr, "chunk sectors must be 1 to %d\n", CHUNK_SECTORS_MAX);
+		return 1;
+	}
+
+	in = fopen(argv[1], "rb");
+	if (in == NULL) { perror(argv[1]); return 1; }
+	fseek(in, 0, SEEK_END);
+	size = ftell(in);
+	fseek(in, 0, SEEK_SET);
+	if (size <= 0 || size % SECTOR_SIZE) {
+		fprintf(stderr, "%s is not a raw image of %d byte sectors\n", argv[1], SECTOR_SIZE);
+		return 1;
+	}
+	sectors = size / SECTOR_SIZE;
+	chunks = (sectors + chunkSectors - 1) / chunkSectors;
+
+	snprintf(tablename, sizeof(tablename), "%s.table", argv[2]);
+	out = fopen(argv[2], "wb");
+	table = fopen(tablename, "wb");
+	if (out == NULL || table == NULL) { perror(argv[2]); return 1; }
+
+	fwrite("PSZ1", 1, 4, table);
+	writeLE32(table, chunkSectors);
+	writeLE32(table, sectors);
+
+	raw = malloc(chunkSectors * SECTOR_SIZE);
+	z = malloc(compressBound(chunkSectors * SECTOR_SIZE));
+	for (i = 0; i < chunks; i++) {
+		size = fread(raw, SECTOR_SIZE, chunkSectors, in) * SECTOR_SIZE;
+		zsize = compressBound(chunkSectors * SECTOR_SIZE);
+		if (compress2(z, &zsize, raw, size, Z_BEST_COMPRESSION) != Z_OK) {
+			fprintf(stderr, "Failed to compress chunk %lu\n", i);
+			return 1;
+		}
+		writeLE32(table, offset);
+		fwrite(z, 1, zsize, out);
+		offset += zsize;
+	}
+	writeLE32(table, offset);	// the end of the last chunk
+
+	free(raw); free(z);
+	fclose(in); fclose(out); fclose(table);
+	printf("%lu sectors in %lu chunks, %lu bytes\n", sectors, chunks, offset);
+	return 0;
+}
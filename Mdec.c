@@ -269,6 +269,7 @@ void psxDma1(u32 adr, u32 bcr, u32 chcr) {
 	size = (bcr>>16)*(bcr&0xffff);
 
     image = (u16*)PSXM(adr);
+	psxMemMarkDirtyRange(adr, size * 4);
 	if (mdec.command&0x08000000) {
 //		MDECOUTDMA_INT(((size * (1000000 / 9000)) / 4) /** 4*/ / BIAS);
 		MDECOUTDMA_INT((size / 4) / BIAS);
@@ -528,13 +529,13 @@ void yuv2rgb24(int *blk,unsigned char *image) {
 	}
 }
 
-int mdecFreeze(gzFile f, int Mode) {
+int mdecFreeze(freezeFile *f, int Mode) {
 	char Unused[4096];
 
 	gzfreeze(&mdec, sizeof(mdec));
 	gzfreezel(iq_y);
 	gzfreezel(iq_uv);
-	gzfreezel(Unused);
+	gzfreezepad(Unused);
 
 	return 0;
 }
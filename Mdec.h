@@ -34,6 +34,6 @@ u32  mdecRead1();
 void psxDma0(u32 madr, u32 bcr, u32 chcr);
 void psxDma1(u32 madr, u32 bcr, u32 chcr);
 void mdec1Interrupt();
-int  mdecFreeze(gzFile f, int Mode);
+int  mdecFreeze(freezeFile *f, int Mode);
 
 #endif /* __MDEC_H__ */
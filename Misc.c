@@ -22,10 +22,13 @@
 * Miscellaneous functions, including savesates and CD-ROM loading.
 */
 
+#include <malloc.h>
+
 #include "Misc.h"
 #include "CdRom.h"
 #include "PsxHw.h"
 #include "Mdec.h"
+#include "Rewind.h"
 
 int Log = 0;
 
@@ -103,6 +106,131 @@ void mmssdd( char *b, char *p )
 	READTRACK(); \
 	memcpy(_dir+2048, buf+12, 2048);
 
+/*
+* ISO9660 index: CheckCdrom walks the whole directory tree of a new disc
+* once and hashes every file by its path, so SYSTEM.CNF, the boot exe and
+* any file loaded later are found without reading directories again.
+*/
+#define CDINDEX_HASH	256
+#define CDINDEX_DEPTH	8
+
+typedef struct {
+	char path[128];		/* upper case, without the ;version */
+	u32 extent;
+	int next;
+} CdromIndexEntry;
+
+static CdromIndexEntry *cdIndex = NULL;
+static int cdIndexCount = 0, cdIndexAlloc = 0;
+static int cdIndexHash[CDINDEX_HASH];
+static int cdIndexValid = 0;
+
+// copies a path as it is kept in the index: upper case, no cdrom:, no
+// leading \ and no ;version
+static void CdromIndexPath(char *dst, const char *src, int len) {
+	int i = 0;
+
+	if (!strnicmp(src, "cdrom:", 6)) { src += 6; len -= 6; }
+	while (len > 0 && *src == '\\') { src++; len--; }
+
+	while (len-- > 0 && *src && *src != ';' && i < 127)
+		dst[i++] = toupper(*src++);
+	dst[i] = 0;
+}
+
+static unsigned int CdromIndexKey(const char *path) {
+	unsigned int h = 0;
+
+	while (*path) h = h * 31 + (u8)*path++;
+	return h % CDINDEX_HASH;
+}
+
+// reads the 2048 bytes of user data of a disc sector
+static u8 *CdromReadSector(u32 lba) {
+	u8 time[4], *buf;
+
+	lba += 150;
+	time[0] = itob(lba / 4500); time[1] = itob((lba / 75) % 60); time[2] = itob(lba % 75);
+	if (CDR_readTrack(time) == -1) return NULL;
+	buf = CDR_getBuffer();
+	return buf ? buf + 12 : NULL;
+}
+
+static u32 CdromIndexLE32(char *b) {
+	return (b[0]&0xff) | ((b[1]&0xff)<<8) | ((b[2]&0xff)<<16) | ((u32)(b[3]&0xff)<<24);
+}
+
+static int CdromIndexDir(u32 lba, u32 size, const char *prefix, int depth) {
+	struct iso_directory_record *dir;
+	u8 sector[2048], *buf;
+	char path[128], name[128];
+	u32 off;
+	int i;
+
+	for (off = 0; off < size; off += 2048) {
+		// recursing reads other sectors, keep our own copy
+		if ((buf = CdromReadSector(lba + off / 2048)) == NULL) return -1;
+		memcpy(sector, buf, 2048);
+
+		// records never cross sectors, the rest of one is zero
+		for (i = 0; i < 2048 && sector[i] != 0; i += sector[i]) {
+			dir = (struct iso_directory_record*) &sector[i];
+			if (i + 33 + dir->name_len[0] > 2048) break;
+			// skip . and ..
+			if (dir->name_len[0] == 1 && (u8)dir->name[0] <= 1) continue;
+
+			CdromIndexPath(name, dir->name, dir->name_len[0]);
+			snprintf(path, sizeof(path), "%s%s", prefix, name);
+
+			if (dir->flags[0] & 0x2) { // it's a dir
+				if (depth < CDINDEX_DEPTH) {
+					strcat(path, "\\");
+					if (CdromIndexDir(CdromIndexLE32(dir->extent),
+							CdromIndexLE32(dir->size), path, depth + 1) == -1) return -1;
+				}
+				continue;
+			}
+
+			if (cdIndexCount == cdIndexAlloc) {
+				CdromIndexEntry *tmp = realloc(cdIndex, (cdIndexAlloc + 256) * sizeof(CdromIndexEntry));
+				if (tmp == NULL) return -1;
+				cdIndex = tmp;
+				cdIndexAlloc += 256;
+			}
+			strcpy(cdIndex[cdIndexCount].path, path);
+			cdIndex[cdIndexCount].extent = CdromIndexLE32(dir->extent);
+			cdIndex[cdIndexCount].next = cdIndexHash[CdromIndexKey(path)];
+			cdIndexHash[CdromIndexKey(path)] = cdIndexCount++;
+		}
+	}
+	return 0;
+}
+
+// indexes the disc from its root directory record, drops it on errors
+static void CdromIndexBuild(struct iso_directory_record *root) {
+	u32 lba = CdromIndexLE32(root->extent), size = CdromIndexLE32(root->size);
+
+	memset(cdIndexHash, -1, sizeof(cdIndexHash));
+	cdIndexCount = 0;
+	cdIndexValid = CdromIndexDir(lba, size, "", 0) == 0;
+	if (cdIndexValid) SysPrintf("CD-ROM index: %d files\n", cdIndexCount);
+}
+
+static int CdromIndexFind(char *filename, u8 *time) {
+	char path[128];
+	int i;
+
+	CdromIndexPath(path, filename, strlen(filename));
+	for (i = cdIndexHash[CdromIndexKey(path)]; i != -1; i = cdIndex[i].next) {
+		if (!strcmp(cdIndex[i].path, path)) {
+			u32 lba = cdIndex[i].extent + 150;
+			time[0] = itob(lba / 4500); time[1] = itob((lba / 75) % 60); time[2] = itob(lba % 75);
+			return 0;
+		}
+	}
+	return -1;
+}
+
 int GetCdromFile(u8 *mdir, u8 *time, char *filename) {
 	struct iso_directory_record *dir;
 	char ddir[4096];
@@ -111,6 +239,8 @@ int GetCdromFile(u8 *mdir, u8 *time, char *filename) {
 
 	// only try to scan if a filename is given
 	if(!strlen((char*)filename)) return -1;
+
+	if (cdIndexValid) return CdromIndexFind(filename, time);
 	
 	i = 0;
 	while (i < 4096) {
@@ -153,16 +283,18 @@ int LoadCdrom() {
 		return 0;
 	}
 
-	time[0] = itob(0); time[1] = itob(2); time[2] = itob(0x10);
+	if (!cdIndexValid) {
+		time[0] = itob(0); time[1] = itob(2); time[2] = itob(0x10);
 
-	READTRACK();
+		READTRACK();
 
-	// skip head and sub, and go to the root directory record
-	dir = (struct iso_directory_record*) &buf[12+156]; 
+		// skip head and sub, and go to the root directory record
+		dir = (struct iso_directory_record*) &buf[12+156]; 
 
-	mmssdd(dir->extent, (char*)time);
+		mmssdd(dir->extent, (char*)time);
 
-	READDIR(mdir);
+		READDIR(mdir);
+	}
 
 	// Load SYSTEM.CNF and scan for the main executable
 	if (GetCdromFile(mdir, time, "SYSTEM.CNF;1") == -1) {
@@ -210,7 +342,10 @@ int LoadCdrom() {
 		incTime();
 		READTRACK();
 
-		if (ptr != NULL) memcpy(ptr, buf+12, 2048);
+		if (ptr != NULL) {
+			memcpy(ptr, buf+12, 2048);
+			psxMemMarkDirtyRange(tmpHead.t_addr, 2048);
+		}
 
 		tmpHead.t_size -= 2048;
 		tmpHead.t_addr += 2048;
@@ -227,16 +362,18 @@ int LoadCdromFile(char *filename, EXE_HEADER *head) {
 
 	sscanf(filename, "cdrom:\\%256s", exename);
 
-	time[0] = itob(0); time[1] = itob(2); time[2] = itob(0x10);
+	if (!cdIndexValid) {
+		time[0] = itob(0); time[1] = itob(2); time[2] = itob(0x10);
 
-	READTRACK();
+		READTRACK();
 
-	// skip head and sub, and go to the root directory record
-	dir = (struct iso_directory_record*) &buf[12+156]; 
+		// skip head and sub, and go to the root directory record
+		dir = (struct iso_directory_record*) &buf[12+156]; 
 
-	mmssdd(dir->extent, (char*)time);
+		mmssdd(dir->extent, (char*)time);
 
-	READDIR(mdir);
+		READDIR(mdir);
+	}
 
 	if (GetCdromFile(mdir, time, (char*)exename) == -1) return -1;
 
@@ -251,6 +388,7 @@ int LoadCdromFile(char *filename, EXE_HEADER *head) {
 		READTRACK();
 
 		memcpy((u8*)(psxMemRLUT[(addr) >> 16] + ((addr) & 0xffff)), (char*)buf+12, 2048);
+		psxMemMarkDirtyRange(addr, 2048);
 
 		size -= 2048;
 		addr += 2048;
@@ -278,9 +416,16 @@ int CheckCdrom() {
 	// skip head and sub, and go to the root directory record
 	dir = (struct iso_directory_record*) &buf[12+156]; 
 
-	mmssdd(dir->extent, (char*)time);
+	// a new disc: index it, and only read the root if that fails
+	memcpy(mdir, dir, 34);
+	CdromIndexBuild((struct iso_directory_record*) mdir);
+	if (!cdIndexValid) {
+		READTRACK();
+		dir = (struct iso_directory_record*) &buf[12+156];
+		mmssdd(dir->extent, (char*)time);
 
-	READDIR(mdir);
+		READDIR(mdir);
+	}
 
 	if (GetCdromFile(mdir, time, "SYSTEM.CNF;1") != -1) {
 		READTRACK();
@@ -404,65 +549,543 @@ int Load(char *ExePath) {
 
 const char PcsxHeader[32] = "STv3 PCSX v";
 
-int SaveState(char *file) {
+#define STATEMEM_HW	0x10000		/* room for the sio/cdr/hw/rcnt/mdec freezes */
+#define STATEMEM_BIOS	0x1000		/* room for psxBiosFreeze */
+
+void freezeData(freezeFile *f, void *ptr, long size, int Mode) {
+	// Mode 2 only adds up the size of a freeze
+	if (Mode == 2) {
+		f->pos += size;
+		return;
+	}
+
+	if (f->mem != NULL) {
+		// past the end only counts, the caller checks pos against size
+		if (f->pos + size <= f->size) {
+			if (Mode == 1) memcpy(f->mem + f->pos, ptr, size);
+			if (Mode == 0) memcpy(ptr, f->mem + f->pos, size);
+		}
+		f->pos += size;
+		return;
+	}
+
+	if (Mode == 1) gzwrite(f->f, ptr, size);
+	if (Mode == 0) gzread(f->f, ptr, size);
+}
+
+static void freezeHw(freezeFile *f, int Mode) {
+	sioFreeze(f, Mode);
+	cdrFreeze(f, Mode);
+	psxHwFreeze(f, Mode);
+	psxRcntFreeze(f, Mode);
+	mdecFreeze(f, Mode);
+}
+
+/*
+* State files (STv4) are sectioned: after the header comes a table of
+* sections, each with an id, version, offset and size, and the sections
+* themselves, page aligned. SaveState gzips the whole file, the offsets
+* are into the unpacked data; unpacked files load as well. Loading finds
+* the sections it knows and skips the others. Each section has its own
+* version; a known one of a newer version or another size than its
+* freeze reads fails the load before anything is touched. STv3 files, one gzipped run of raw structs, still load.
+*
+* The state is built in, and read into, a memory buffer. The file I/O
+* and the compression run on a thread, so SaveState only costs the copy.
+* A LoadStateBegin ahead of LoadState leaves only the swap in. Elsewhere
+* than on GameCube the I/O runs at once, in the caller.
+*/
+#ifdef __GAMECUBE__
+#include <gccore.h>
+#define STATE_THREADED
+#define STATE_STACK_SIZE (16*1024)
+#define STATE_PRIORITY 40
+#endif
+#define STATE_PIC		(128*96*3)
+#define STATE_PAGE		4096
+#define STATE_SECTIONS	16
+#define STATE_V4		"STv4 PCSX"
+
+#define stateAlign(size) (((size) + STATE_PAGE - 1) & ~(STATE_PAGE - 1))
+
+typedef struct {
+	char magic[32];
+	u32 sections;		/* all u32 are little endian */
+	u32 reserved[3];
+} StateHeader;
+
+typedef struct {
+	char id[8];
+	u32 version;
+	u32 offset;			/* from the start of the file */
+	u32 size;
+	u32 reserved;
+} StateSection;
+
+/* the version each section is written with, bump a section's on layout
+   changes; older device sections load if their freeze still reads them */
+static const struct {
+	char id[8];
+	u32 version;
+} stateVersions[] = {
+	{ "PIC", 1 }, { "HLE", 1 }, { "RAM", 1 }, { "PSXH", 1 }, { "CPU", 1 },
+	{ "GPU", 1 }, { "SPU", 1 }, { "SIO", 1 },
+	{ "CDR", 2 },	/* 2: the plugin's cd audio position */
+	{ "HW", 1 }, { "RCNT", 1 }, { "MDEC", 1 }
+};
+
+static u32 stateVersion(const char *id) {
+	int i;
+
+	for (i = 0; i < (int)(sizeof(stateVersions) / sizeof(stateVersions[0])); i++)
+		if (!strncmp(stateVersions[i].id, id, 8)) return stateVersions[i].version;
+	return 0;
+}
+
+typedef struct {
+	char file[MAXPATHLEN];
+	unsigned char *data;
+	long size;
+	int gz;			/* write the file gzipped */
+	int result;		/* 0 ok, -1 failed, 1 not done yet */
+} StateIo;
+
+static StateIo stWrite, stRead;
+static volatile int stJob;	/* 1 write, 2 read */
+
+static long stateSpuSize() {
+	u32 info[8];	// just the SPUFreeze_t header
+	SPUFreeze_t *spufP = (SPUFreeze_t *) info;
+
+	memset(info, 0, sizeof(info));
+	SPU_freeze(2, spufP);
+
+	return spufP->Size;
+}
+
+// the most a state file can take with the SPU plugin's freeze
+static long stateFileSize() {
+	return stateAlign(sizeof(StateHeader) + STATE_SECTIONS * sizeof(StateSection)) +
+		stateAlign(STATE_PIC) + 0x00200000 + stateAlign(STATEMEM_BIOS) + 0x00010000 +
+		stateAlign(sizeof(psxRegs)) + stateAlign(sizeof(GPUFreeze_t)) +
+		stateAlign(stateSpuSize()) + 5 * STATE_PAGE + STATEMEM_HW;
+}
+
+static void stateFreeData(StateIo *io) {
+	free(io->data);
+	io->data = NULL;
+}
+
+// writes a temporary file and renames it over the state, so a failed or
+// cut off write never leaves half a state behind
+static void stateWriteFile() {
+	char tmp[MAXPATHLEN];
+	FILE *f;
+
+	stWrite.result = -1;
+	snprintf(tmp, MAXPATHLEN, "%s.tmp", stWrite.file);
+	if (stWrite.gz) {
+		// fastest level, it's the thread's time but the next save waits
+		gzFile gz = gzopen(tmp, "wb1");
+		if (gz == NULL) return;
+		if (gzwrite(gz, stWrite.data, stWrite.size) == stWrite.size) stWrite.result = 0;
+		if (gzclose(gz) != Z_OK) stWrite.result = -1;
+	} else {
+		f = fopen(tmp, "wb");
+		if (f == NULL) return;
+		if (fwrite(stWrite.data, 1, stWrite.size, f) == (size_t)stWrite.size) stWrite.result = 0;
+		if (fclose(f) != 0) stWrite.result = -1;
+	}
+
+	if (stWrite.result == 0 && rename(tmp, stWrite.file) != 0) {
+		// not every file system renames over an existing file
+		remove(stWrite.file);
+		if (rename(tmp, stWrite.file) != 0) stWrite.result = -1;
+	}
+	if (stWrite.result != 0) remove(tmp);
+}
+
+// STv3 and saved STv4 files are gzipped, stRead.size comes in as the
+// most to read
+static void stateReadGz() {
 	gzFile f;
-	GPUFreeze_t *gpufP;
-	SPUFreeze_t *spufP;
+	long alloc = stRead.size;
+	int n;
+
+	stRead.size = 0;
+	if ((stRead.data = (unsigned char *) malloc(alloc)) == NULL) return;
+
+	f = gzopen(stRead.file, "rb");
+	if (f == NULL) return;
+	// SPU plugins differ, so does the size; read until the end
+	n = gzread(f, stRead.data, alloc);
+	gzclose(f);
+	if (n < 32 || (strncmp(PcsxHeader, (char *)stRead.data, 9) &&
+		strncmp(STATE_V4, (char *)stRead.data, 9))) return;
+
+	stRead.size = n;
+	stRead.result = 0;
+}
+
+static void stateReadFile() {
+	char magic[9];
+	FILE *f;
+	long size;
+
+	stRead.result = -1;
+	stateFreeData(&stRead);
+
+	f = fopen(stRead.file, "rb");
+	if (f == NULL) return;
+	if (fread(magic, 1, 9, f) != 9 || strncmp(STATE_V4, magic, 9)) {
+		fclose(f);
+		stateReadGz();
+		return;
+	}
+
+	fseek(f, 0, SEEK_END);
+	size = ftell(f);
+
+	fseek(f, 0, SEEK_SET);
+	stRead.data = (unsigned char *) malloc(size);
+	if (stRead.data != NULL && fread(stRead.data, 1, size, f) == (size_t)size) {
+		stRead.size = size;
+		stRead.result = 0;
+	}
+	fclose(f);
+}
+
+static void stateDoJob() {
+	if (stJob == 1) {
+		stateWriteFile();
+		stateFreeData(&stWrite);
+	}
+	if (stJob == 2) stateReadFile();
+}
+
+#ifdef STATE_THREADED
+static lwp_t stThread;
+static int stRunning = 0;
+static sem_t stWork, stDone;
+static char stStack[STATE_STACK_SIZE];
+
+static void *stateThread(void *arg) {
+	for (;;) {
+		LWP_SemWait(stWork);
+		stateDoJob();
+		stJob = 0;
+		LWP_SemPost(stDone);
+	}
+	return NULL;
+}
+#endif
+
+static void stateStartJob(int job) {
+	stJob = job;
+#ifdef STATE_THREADED
+	if (!stRunning) {
+		stRunning = 1;
+		LWP_SemInit(&stWork, 0, 1);
+		LWP_SemInit(&stDone, 0, 1);
+		LWP_CreateThread(&stThread, stateThread, NULL, stStack, STATE_STACK_SIZE, STATE_PRIORITY);
+	}
+	LWP_SemPost(stWork);
+#else
+	stateDoJob();
+	stJob = 0;
+#endif
+}
+
+// waits for the state file I/O, returns how the last write went
+int SaveStateWait() {
+#ifdef STATE_THREADED
+	while (stJob) LWP_SemWait(stDone);
+#endif
+	return stWrite.result;
+}
+
+// hands data, allocated with malloc, to the file thread to write file,
+// gzipped if gz is set
+static void stateStartWrite(char *file, unsigned char *data, long size, int gz) {
+	strncpy(stWrite.file, file, MAXPATHLEN - 1);
+	stWrite.data = data;
+	stWrite.size = size;
+	stWrite.gz = gz;
+	stWrite.result = 1;
+	stateStartJob(1);
+}
+
+// starts a section at the next page, returns where its data goes
+static unsigned char *stateBeginSection(freezeFile *ff, const char *id) {
+	StateHeader *h = (StateHeader *) ff->mem;
+	StateSection *sec = (StateSection *) (h + 1) + SWAPu32(h->sections);
+
+	ff->pos = stateAlign(ff->pos);
+
+	memset(sec, 0, sizeof(StateSection));
+	strncpy(sec->id, id, 8);
+	sec->version = SWAPu32(stateVersion(id));
+	sec->offset = SWAPu32(ff->pos);
+	h->sections = SWAPu32(SWAPu32(h->sections) + 1);
+
+	return ff->mem + ff->pos;
+}
+
+static void stateEndSection(freezeFile *ff, long size) {
+	StateHeader *h = (StateHeader *) ff->mem;
+	StateSection *sec = (StateSection *) (h + 1) + SWAPu32(h->sections) - 1;
+
+	if (size >= 0) ff->pos = SWAPu32(sec->offset) + size;
+	sec->size = SWAPu32(ff->pos - SWAPu32(sec->offset));
+}
+
+// a device freeze in a section of its own
+static void stateFreezeSection(freezeFile *ff, const char *id, int (*freeze)(freezeFile *, int)) {
+	stateBeginSection(ff, id);
+	freeze(ff, 1);
+	stateEndSection(ff, -1);
+}
+
+static StateSection *stateFindSection(unsigned char *data, long size, const char *id) {
+	StateHeader *h = (StateHeader *) data;
+	StateSection *sec = (StateSection *) (h + 1);
+	u32 i, n = SWAPu32(h->sections);
+
+	if ((long)(sizeof(StateHeader) + n * sizeof(StateSection)) > size) return NULL;
+
+	for (i = 0; i < n; i++, sec++) {
+		if (strncmp(sec->id, id, 8)) continue;
+		if (SWAPu32(sec->offset) + SWAPu32(sec->size) > (u32)size) return NULL;
+		return sec;
+	}
+	return NULL;
+}
+
+// want is the size the section has to have, or the most it may have with max
+static unsigned char *stateSectionData(unsigned char *data, long size, const char *id, u32 want, int max) {
+	StateSection *sec = stateFindSection(data, size, id);
+
+	if (sec == NULL || SWAPu32(sec->version) != stateVersion(id)) return NULL;
+	if (max ? SWAPu32(sec->size) > want : SWAPu32(sec->size) != want) return NULL;
+	return data + SWAPu32(sec->offset);
+}
+
+// -1 when a device section is there but not what the freeze reads now
+static int stateCheckSection(unsigned char *data, long size, const char *id, int (*freeze)(freezeFile *, int)) {
+	freezeFile ff = { NULL, NULL, 0, 0, 1 };
+	StateSection *sec = stateFindSection(data, size, id);
+
+	if (sec == NULL) return 0;
+	ff.version = SWAPu32(sec->version);
+	if (ff.version < 1 || ff.version > (int)stateVersion(id)) return -1;
+	freeze(&ff, 2);
+	if (SWAPu32(sec->size) != (u32)ff.pos) return -1;
+	return 0;
+}
+
+static void stateLoadSection(unsigned char *data, long size, const char *id, int (*freeze)(freezeFile *, int)) {
+	freezeFile ff = { NULL, NULL, 0, 0, 1 };
+	StateSection *sec = stateFindSection(data, size, id);
+
+	if (sec == NULL) return;
+	ff.mem = data + SWAPu32(sec->offset);
+	ff.size = SWAPu32(sec->size);
+	ff.version = SWAPu32(sec->version);
+	freeze(&ff, 0);
+}
+
+static int stateLoadV4(unsigned char *data, long size) {
+	unsigned char *ram, *hw, *regs, *gpu, *spu, *bios;
+
+	ram = stateSectionData(data, size, "RAM", 0x00200000, 0);
+	hw = stateSectionData(data, size, "PSXH", 0x00010000, 0);
+	regs = stateSectionData(data, size, "CPU", sizeof(psxRegs), 0);
+	gpu = stateSectionData(data, size, "GPU", sizeof(GPUFreeze_t), 0);
+	spu = stateSectionData(data, size, "SPU", stateSpuSize(), 0);
+	if (ram == NULL || hw == NULL || regs == NULL || gpu == NULL || spu == NULL) return -1;
+
+	bios = NULL;
+	if (Config.HLE && stateFindSection(data, size, "HLE") != NULL &&
+		(bios = stateSectionData(data, size, "HLE", 0x00040000, 1)) == NULL) return -1;
+
+	if (stateCheckSection(data, size, "SIO", sioFreeze) == -1 ||
+		stateCheckSection(data, size, "CDR", cdrFreeze) == -1 ||
+		stateCheckSection(data, size, "HW", psxHwFreeze) == -1 ||
+		stateCheckSection(data, size, "RCNT", psxRcntFreeze) == -1 ||
+		stateCheckSection(data, size, "MDEC", mdecFreeze) == -1) return -1;
+
+	psxCpu->Reset();
+
+	memcpy(psxM, ram, 0x00200000);
+	memcpy(psxH, hw, 0x00010000);
+	memcpy(&psxRegs, regs, sizeof(psxRegs));
+
+	if (bios != NULL) {
+		memcpy(&psxR[0x40000], bios, SWAPu32(stateFindSection(data, size, "HLE")->size));
+		psxBiosFreeze(0);
+	}
+
+	GPU_freeze(0, (GPUFreeze_t *) gpu);
+	SPU_freeze(0, (SPUFreeze_t *) spu);
+
+	stateLoadSection(data, size, "SIO", sioFreeze);
+	stateLoadSection(data, size, "CDR", cdrFreeze);
+	stateLoadSection(data, size, "HW", psxHwFreeze);
+	stateLoadSection(data, size, "RCNT", psxRcntFreeze);
+	stateLoadSection(data, size, "MDEC", mdecFreeze);
+
+	return 0;
+}
+
+// an STv3 file, after its header and screen shot
+static int stateLoadV3(unsigned char *data, long size) {
+	freezeFile ff = { NULL, NULL, 0, 0, 0, 1 };
 	int Size;
-	unsigned char *pMem;
 
-	f = gzopen(file, "wb");
-	if (f == NULL) return -1;
+	ff.mem = data;
+	ff.size = size;
+	// GPU and SPU freezes have to be there before anything is touched
+	ff.pos = 32 + STATE_PIC + 0x00200000 + 0x00080000 + 0x00010000 +
+		sizeof(psxRegs) + sizeof(GPUFreeze_t);
+	if (ff.pos + 4 > ff.size) return -1;
+	memcpy(&Size, ff.mem + ff.pos, 4);
+	if (Size <= 0 || ff.pos + 4 + Size > ff.size) return -1;
+	ff.pos = 32 + STATE_PIC;
 
-	gzwrite(f, (void*)PcsxHeader, 32);
+	psxCpu->Reset();
 
-	pMem = (unsigned char *) malloc(128*96*3);
-	if (pMem == NULL) return -1;
-	GPU_getScreenPic(pMem);
-	gzwrite(f, pMem, 128*96*3);
-	free(pMem);
+	freezeData(&ff, psxM, 0x00200000, 0);
+	freezeData(&ff, psxR, 0x00080000, 0);
+	freezeData(&ff, psxH, 0x00010000, 0);
+	freezeData(&ff, &psxRegs, sizeof(psxRegs), 0);
 
 	if (Config.HLE)
-		psxBiosFreeze(1);
+		psxBiosFreeze(0);
+
+	GPU_freeze(0, (GPUFreeze_t *)(ff.mem + ff.pos));
+	ff.pos += sizeof(GPUFreeze_t);
+
+	freezeData(&ff, &Size, 4, 0);
+	SPU_freeze(0, (SPUFreeze_t *)(ff.mem + ff.pos));
+	ff.pos += Size;
+
+	freezeHw(&ff, 0);
+
+	return 0;
+}
+
+// the BIOS cache leaves out the CDR, which depends on the disc in the drive
+static int stateSave(char *file, int cdr) {
+	freezeFile ff = { NULL, NULL, 0, 0, 1 };
+	StateHeader *h;
+	GPUFreeze_t *gpufP;
+	unsigned char *p;
+	long spuSize;
+
+	// one state in flight
+	SaveStateWait();
+
+	// a LoadStateBegin of this file read what we're replacing
+	if (stRead.result != -1 && !strcmp(stRead.file, file)) {
+		stateFreeData(&stRead);
+		stRead.result = -1;
+	}
+
+	spuSize = stateSpuSize();
+	ff.size = stateFileSize();
+	ff.mem = (unsigned char *) memalign(32, ff.size);
+	if (ff.mem == NULL) return -1;
+	memset(ff.mem, 0, ff.size);
+
+	h = (StateHeader *) ff.mem;
+	strcpy(h->magic, STATE_V4 " v");
+	ff.pos = sizeof(StateHeader) + STATE_SECTIONS * sizeof(StateSection);
 
-	gzwrite(f, psxM, 0x00200000);
-	gzwrite(f, psxR, 0x00080000);
-	gzwrite(f, psxH, 0x00010000);
-	gzwrite(f, (void*)&psxRegs, sizeof(psxRegs));
+	p = stateBeginSection(&ff, "PIC");
+	if (GPU_getScreenPic(p) == -1) memset(p, 0, STATE_PIC);
+	stateEndSection(&ff, STATE_PIC);
 
-	// gpu
-	gpufP = (GPUFreeze_t *) malloc(sizeof(GPUFreeze_t));
+	if (Config.HLE) {
+		p = stateBeginSection(&ff, "HLE");
+		stateEndSection(&ff, psxBiosFreeze(1));
+		memcpy(p, &psxR[0x40000], ff.pos - (p - ff.mem));
+	}
+
+	memcpy(stateBeginSection(&ff, "RAM"), psxM, 0x00200000);
+	stateEndSection(&ff, 0x00200000);
+	memcpy(stateBeginSection(&ff, "PSXH"), psxH, 0x00010000);
+	stateEndSection(&ff, 0x00010000);
+	memcpy(stateBeginSection(&ff, "CPU"), &psxRegs, sizeof(psxRegs));
+	stateEndSection(&ff, sizeof(psxRegs));
+
+	gpufP = (GPUFreeze_t *) stateBeginSection(&ff, "GPU");
 	gpufP->ulFreezeVersion = 1;
 	GPU_freeze(1, gpufP);
-	gzwrite(f, gpufP, sizeof(GPUFreeze_t));
-	free(gpufP);
+	stateEndSection(&ff, sizeof(GPUFreeze_t));
 
-	// spu
-	spufP = (SPUFreeze_t *) malloc(16);
-	SPU_freeze(2, spufP);
-	Size = spufP->Size; gzwrite(f, &Size, 4);
-	free(spufP);
-	spufP = (SPUFreeze_t *) malloc(Size);
-	SPU_freeze(1, spufP);
-	gzwrite(f, spufP, Size);
-	free(spufP);
-
-	sioFreeze(f, 1);
-	cdrFreeze(f, 1);
-	psxHwFreeze(f, 1);
-	psxRcntFreeze(f, 1);
-	mdecFreeze(f, 1);
+	SPU_freeze(1, (SPUFreeze_t *) stateBeginSection(&ff, "SPU"));
+	stateEndSection(&ff, spuSize);
 
-	gzclose(f);
+	stateFreezeSection(&ff, "SIO", sioFreeze);
+	if (cdr) stateFreezeSection(&ff, "CDR", cdrFreeze);
+	stateFreezeSection(&ff, "HW", psxHwFreeze);
+	stateFreezeSection(&ff, "RCNT", psxRcntFreeze);
+	stateFreezeSection(&ff, "MDEC", mdecFreeze);
+
+	if (ff.pos > ff.size) { free(ff.mem); return -1; }
+
+	stateStartWrite(file, ff.mem, ff.pos, 1);
+
+	return 0;
+}
+
+int SaveState(char *file) {
+	return stateSave(file, 1);
+}
+
+// reads a state file ahead of LoadState
+int LoadStateBegin(char *file) {
+	SaveStateWait();
+
+	strncpy(stRead.file, file, MAXPATHLEN - 1);
+	// room for an STv3 file too, it holds all of psxR
+	stRead.size = stateFileSize() + 0x00080000 + STATEMEM_HW;
+	stRead.result = 1;
+	stateStartJob(2);
 
 	return 0;
 }
 
 int LoadState(char *file) {
+	int ret;
+
+	// a write of this file in flight has to land first
+	SaveStateWait();
+	if (stRead.result != 0 || strcmp(stRead.file, file)) {
+		LoadStateBegin(file);
+		SaveStateWait();
+	}
+	if (stRead.result != 0) return -1;
+
+	if (!strncmp(STATE_V4, (char *)stRead.data, 9))
+		 ret = stateLoadV4(stRead.data, stRead.size);
+	else ret = stateLoadV3(stRead.data, stRead.size);
+
+	stateFreeData(&stRead);
+	stRead.result = -1;
+	// a refused state left the machine as it was
+	if (ret != 0) return ret;
+
+	// no longer the RAM of the last in-memory base
+	psxMemDirtyAll();
+	// nor the game the rewind states are of
+	RewindReset();
+
+	return 0;
+}
+
+int CheckState(char *file) {
 	gzFile f;
-	GPUFreeze_t *gpufP;
-	SPUFreeze_t *spufP;
-	int Size;
 	char header[32];
 
 	f = gzopen(file, "rb");
@@ -472,60 +1095,427 @@ int LoadState(char *file) {
 
 	gzread(f, header, 32);
 
-	if (strncmp("STv3 PCSX", header, 9)) { gzclose(f); return -1; }
+	gzclose(f);
+
+	if (strncmp(PcsxHeader, header, 9) && strncmp(STATE_V4, header, 9)) return -1;
+
+	return 0;
+}
+
+/*
+* The BIOS intro costs tens of millions of cycles on every boot and
+* always ends in the same state for the same BIOS image. That state is
+* kept as a state file named after the image's crc and the video system,
+* and later boots load it instead of running the BIOS again. LoadState
+* refuses one whose sections don't fit this build; the BIOS then runs
+* and its state is saved over the old one.
+*
+* The same cache serves every disc, so it has no CDR section: the drive
+* is reset after the load and starts out on the disc in it now. The GPU
+* has nothing of the disc yet, the shell at 0x80030000 draws the logo.
+* Both run from psxReset and need the plugins open, LoadState and
+* SaveState freeze them.
+*/
+static void biosStatePath(char *path) {
+	uLong crc = crc32(0L, (Bytef *) psxR, 0x00080000);
+
+	snprintf(path, MAXPATHLEN, "%sbios-%08lx-%ld.sta", Config.BiosDir, crc, Config.PsxType);
+}
 
-	gzseek(f, 128*96*3, SEEK_CUR);
+// -1 when there's no state for this BIOS; the machine is left alone then
+int LoadBiosState() {
+	char path[MAXPATHLEN];
 
-	gzread(f, psxM, 0x00200000);
-	gzread(f, psxR, 0x00080000);
-	gzread(f, psxH, 0x00010000);
-	gzread(f, (void*)&psxRegs, sizeof(psxRegs));
+	if (!Config.BiosCache) return -1;
+
+	biosStatePath(path);
+	if (LoadState(path) == -1) return -1;
+	// the disc in the drive now, not the one of the boot that saved it
+	cdrReset();
+
+	SysPrintf("Booted from %s\n", path);
+	return 0;
+}
+
+// called at the end of the BIOS intro
+void SaveBiosState() {
+	char path[MAXPATHLEN];
+
+	if (!Config.BiosCache) return;
+
+	biosStatePath(path);
+	stateSave(path, 0);
+}
+
+/*
+* In-memory states: the same data as a state file, uncompressed and
+* without the screen shot, kept in one buffer allocated by StateMemInit.
+* The BIOS image never changes, only the HLE block in it is kept.
+* GPU and SPU freeze straight into the buffer, so nothing is allocated
+* per save or load.
+*/
+static long stateMemAlign(long pos) {
+	return (pos + 31) & ~31;
+}
+
+int StateMemInit(StateMem *st) {
+	u32 info[8];	// just the SPUFreeze_t header, mode 2 fills nothing else
+	SPUFreeze_t *spufP = (SPUFreeze_t *) info;
+	long size;
+
+	memset(info, 0, sizeof(info));
+	SPU_freeze(2, spufP);
+
+	size = 0x00200000 + 0x00010000 + stateMemAlign(sizeof(psxRegs)) + STATEMEM_BIOS +
+		stateMemAlign(sizeof(GPUFreeze_t)) + stateMemAlign(spufP->Size) + STATEMEM_HW;
+
+	if (st->data != NULL && st->alloc >= size) return 0;
+
+	free(st->data);
+	st->data = (unsigned char *) memalign(32, size);
+	st->alloc = st->data ? size : 0;
+	st->size = 0;
+	st->spuSize = spufP->Size;
+
+	return st->data ? 0 : -1;
+}
+
+void StateMemFree(StateMem *st) {
+	free(st->data);
+	st->data = NULL;
+	st->alloc = st->size = 0;
+}
+
+// everything but psxM, returns the bytes used or -1 if size is too small
+static long stateMemSaveRest(unsigned char *data, long size, long spuSize) {
+	freezeFile ff = { NULL, NULL, 0, 0, 1 };
+	GPUFreeze_t *gpufP;
+	unsigned char *p = data;
+
+	memcpy(p, psxH, 0x00010000); p += 0x00010000;
+	memcpy(p, &psxRegs, sizeof(psxRegs)); p += stateMemAlign(sizeof(psxRegs));
 
 	if (Config.HLE)
+		memcpy(p, &psxR[0x40000], psxBiosFreeze(1));
+	p += STATEMEM_BIOS;
+
+	gpufP = (GPUFreeze_t *) p;
+	gpufP->ulFreezeVersion = 1;
+	GPU_freeze(1, gpufP);
+	p += stateMemAlign(sizeof(GPUFreeze_t));
+
+	SPU_freeze(1, (SPUFreeze_t *) p);
+	p += stateMemAlign(spuSize);
+
+	ff.mem = p;
+	ff.size = size - (p - data);
+	freezeHw(&ff, 1);
+	if (ff.pos > ff.size) return -1;
+
+	return (p - data) + ff.pos;
+}
+
+static void stateMemLoadRest(unsigned char *data, long size, long spuSize) {
+	freezeFile ff = { NULL, NULL, 0, 0, 1 };
+	unsigned char *p = data;
+
+	memcpy(psxH, p, 0x00010000); p += 0x00010000;
+	memcpy(&psxRegs, p, sizeof(psxRegs)); p += stateMemAlign(sizeof(psxRegs));
+
+	if (Config.HLE) {
+		memcpy(&psxR[0x40000], p, STATEMEM_BIOS);
 		psxBiosFreeze(0);
+	}
+	p += STATEMEM_BIOS;
 
-	// gpu
-	gpufP = (GPUFreeze_t *) malloc (sizeof(GPUFreeze_t));
-	gzread(f, gpufP, sizeof(GPUFreeze_t));
-	GPU_freeze(0, gpufP);
-	free(gpufP);
-
-	// spu
-	gzread(f, &Size, 4);
-	spufP = (SPUFreeze_t *) malloc (Size);
-	gzread(f, spufP, Size);
-	SPU_freeze(0, spufP);
-	free(spufP);
-
-	sioFreeze(f, 0);
-	cdrFreeze(f, 0);
-	psxHwFreeze(f, 0);
-	psxRcntFreeze(f, 0);
-	mdecFreeze(f, 0);
+	GPU_freeze(0, (GPUFreeze_t *) p);
+	p += stateMemAlign(sizeof(GPUFreeze_t));
 
-	gzclose(f);
+	SPU_freeze(0, (SPUFreeze_t *) p);
+	p += stateMemAlign(spuSize);
+
+	ff.mem = p;
+	ff.size = size - (p - data);
+	freezeHw(&ff, 0);
+}
+
+// Snap/RestoreStateMem leave the base the dirty pages are tracked
+// against alone, Save/LoadStateMem make their state that base
+int SnapStateMem(StateMem *st) {
+	long rest;
+
+	if (StateMemInit(st) == -1) return -1;
+
+	memcpy(st->data, psxM, 0x00200000);
+	rest = stateMemSaveRest(st->data + 0x00200000, st->alloc - 0x00200000, st->spuSize);
+	if (rest == -1) return -1;
+
+	st->size = 0x00200000 + rest;
 
 	return 0;
 }
 
-int CheckState(char *file) {
-	gzFile f;
-	char header[32];
+int RestoreStateMem(StateMem *st) {
+	if (st->data == NULL || st->size == 0) return -1;
 
-	f = gzopen(file, "rb");
-	if (f == NULL) return -1;
+	psxCpu->Reset();
+
+	memcpy(psxM, st->data, 0x00200000);
+	stateMemLoadRest(st->data + 0x00200000, st->size - 0x00200000, st->spuSize);
+	psxMemDirtyAll();
+
+	return 0;
+}
+
+// RestoreStateMem for a state of this run that only the pages set in
+// dirty were written since: just those go back, and only the code
+// compiled from them is dropped instead of all of it
+int RestoreStateMemPages(StateMem *st, u32 *dirty) {
+	int i;
+
+	if (st->data == NULL || st->size == 0) return -1;
+
+	for (i = 0; i < PSXMEM_PAGES; i++) {
+		if (!(dirty[i >> 5] & (1 << (i & 31)))) continue;
+		memcpy(psxM + (i << PSXMEM_PAGE_SHIFT), st->data + (i << PSXMEM_PAGE_SHIFT), 1 << PSXMEM_PAGE_SHIFT);
+		psxCpu->Clear(i << PSXMEM_PAGE_SHIFT, (1 << PSXMEM_PAGE_SHIFT) / 4);
+	}
+	stateMemLoadRest(st->data + 0x00200000, st->size - 0x00200000, st->spuSize);
+
+	return 0;
+}
+
+int SaveStateMem(StateMem *st) {
+	if (SnapStateMem(st) == -1) return -1;
+
+	psxMemDirtyClear();
+
+	return 0;
+}
+
+int LoadStateMem(StateMem *st) {
+	if (RestoreStateMem(st) == -1) return -1;
+
+	psxMemDirtyClear();
+
+	return 0;
+}
+
+/*
+* Delta states keep only the RAM pages written since the last
+* SaveStateMem/LoadStateMem, which is their base, plus the rest of the
+* state in full.
+*/
+int SaveStateDelta(StateMem *base, StateDelta *d) {
+	unsigned char *p;
+	long rest;
+	int i;
+
+	if (base->data == NULL || base->size == 0) return -1;
+
+	if (d->data == NULL || d->alloc < base->alloc) {
+		free(d->data);
+		// worst case is every page
+		d->data = (unsigned char *) memalign(32, base->alloc);
+		d->alloc = d->data ? base->alloc : 0;
+		if (d->data == NULL) return -1;
+	}
+
+	memcpy(d->dirty, psxMemDirty, sizeof(d->dirty));
+
+	p = d->data;
+	d->pages = 0;
+	for (i = 0; i < PSXMEM_PAGES; i++) {
+		if (!(d->dirty[i >> 5] & (1 << (i & 31)))) continue;
+		memcpy(p, psxM + (i << PSXMEM_PAGE_SHIFT), 1 << PSXMEM_PAGE_SHIFT);
+		p += 1 << PSXMEM_PAGE_SHIFT;
+		d->pages++;
+	}
+
+	d->spuSize = base->spuSize;
+	rest = stateMemSaveRest(p, d->alloc - (p - d->data), d->spuSize);
+	if (rest == -1) return -1;
+
+	d->size = (p - d->data) + rest;
+
+	return 0;
+}
+
+int LoadStateDelta(StateMem *base, StateDelta *d) {
+	unsigned char *p = d->data;
+	int i;
+
+	if (base->data == NULL || base->size == 0 || p == NULL || d->size == 0) return -1;
 
 	psxCpu->Reset();
 
-	gzread(f, header, 32);
+	memcpy(psxM, base->data, 0x00200000);
+	for (i = 0; i < PSXMEM_PAGES; i++) {
+		if (!(d->dirty[i >> 5] & (1 << (i & 31)))) continue;
+		memcpy(psxM + (i << PSXMEM_PAGE_SHIFT), p, 1 << PSXMEM_PAGE_SHIFT);
+		p += 1 << PSXMEM_PAGE_SHIFT;
+	}
+	stateMemLoadRest(p, d->size - (p - d->data), d->spuSize);
 
-	gzclose(f);
+	// RAM differs from the base in just these pages again
+	memcpy(psxMemDirty, d->dirty, sizeof(d->dirty));
 
-	if (strncmp("STv3 PCSX", header, 9)) return -1;
+	return 0;
+}
+
+void StateDeltaFree(StateDelta *d) {
+	free(d->data);
+	d->data = NULL;
+	d->alloc = d->size = 0;
+	d->pages = 0;
+}
+
+/*
+* Autosave: every Config.AutoSave vsyncs the state goes to the card
+* through the state file thread. The first one, and any after more
+* than half the RAM was written, is a whole in-memory state, the
+* base; the rest are deltas against it, which keep only the written
+* pages. Both files name the base they belong to, so a delta left
+* from an older base is never loaded over a newer one. The data is
+* in this build's byte order and layout, nothing else reads it back.
+*/
+#define AUTOSTATE_MAGIC	"ASv1 PCSX"
+#define AUTOSTATE_VERSION	1	/* of the in-memory layout, bump on any freeze's change */
+
+typedef struct {
+	char magic[16];
+	u32 version;		/* AUTOSTATE_VERSION */
+	u32 base;			/* the id of the base, a delta goes with */
+	u32 spuSize;
+	u32 size;			/* of the data after the header */
+	u32 dirty[PSXMEM_PAGES / 32];	/* the pages in a delta, 0 in a base */
+} AutoStateHeader;
+
+static StateMem asBase;
+static StateDelta asDelta;
+static u32 asBaseId;
+static int asFrames;
+
+static void autoStatePath(char *path, const char *ext) {
+	snprintf(path, MAXPATHLEN, "%sauto-%.9s.%s", Config.BiosDir, CdromId, ext);
+}
+
+static int autoStateWrite(const char *ext, u32 *dirty, unsigned char *data, long size, long spuSize) {
+	char path[MAXPATHLEN];
+	AutoStateHeader *h;
+
+	h = (AutoStateHeader *) malloc(sizeof(AutoStateHeader) + size);
+	if (h == NULL) return -1;
+	memset(h, 0, sizeof(AutoStateHeader));
+	strcpy(h->magic, AUTOSTATE_MAGIC);
+	h->version = AUTOSTATE_VERSION;
+	h->base = asBaseId;
+	h->spuSize = spuSize;
+	h->size = size;
+	if (dirty != NULL) memcpy(h->dirty, dirty, sizeof(h->dirty));
+	memcpy(h + 1, data, size);
+
+	autoStatePath(path, ext);
+	stateStartWrite(path, (unsigned char *) h, sizeof(AutoStateHeader) + size, 0);
 
 	return 0;
 }
 
+// reads the header and checks it fits, the data is left to read
+static FILE *autoStateOpen(const char *ext, AutoStateHeader *h, long alloc) {
+	char path[MAXPATHLEN];
+	FILE *f;
+
+	autoStatePath(path, ext);
+	f = fopen(path, "rb");
+	if (f == NULL) return NULL;
+	if (fread(h, 1, sizeof(AutoStateHeader), f) != sizeof(AutoStateHeader) ||
+		strncmp(h->magic, AUTOSTATE_MAGIC, sizeof(h->magic)) || h->version != AUTOSTATE_VERSION ||
+		h->spuSize != (u32)asBase.spuSize || h->size > (u32)alloc) {
+		fclose(f);
+		return NULL;
+	}
+
+	return f;
+}
+
+static int autoStateDirtyPages() {
+	int i, n = 0;
+
+	for (i = 0; i < PSXMEM_PAGES; i++)
+		if (psxMemDirty[i >> 5] & (1 << (i & 31))) n++;
+
+	return n;
+}
+
+// called every vsync
+void AutoStateFrame() {
+	if (Config.AutoSave <= 0 || ++asFrames < Config.AutoSave) return;
+	// the last one is still being written, try again next vsync
+	if (stJob) return;
+	asFrames = 0;
+
+	if (asBase.size == 0 || autoStateDirtyPages() > PSXMEM_PAGES / 2) {
+		if (SaveStateMem(&asBase) == -1) {
+			SysPrintf("Autosave off: no memory for its state\n");
+			AutoStateShutdown();
+			Config.AutoSave = 0;
+			return;
+		}
+		// a new id, also across runs
+		asBaseId = (u32)time(NULL) > asBaseId ? (u32)time(NULL) : asBaseId + 1;
+		autoStateWrite("sta", NULL, asBase.data, asBase.size, asBase.spuSize);
+	} else {
+		if (SaveStateDelta(&asBase, &asDelta) == -1) return;
+		autoStateWrite("dlt", asDelta.dirty, asDelta.data, asDelta.size, asDelta.spuSize);
+	}
+}
+
+// resumes from the autosave of the game in the drive, -1 if it has none
+int LoadAutoState() {
+	AutoStateHeader h;
+	FILE *f;
+	int ret = -1;
+
+	SaveStateWait();
+	if (StateMemInit(&asBase) == -1) return -1;
+
+	f = autoStateOpen("sta", &h, asBase.alloc);
+	if (f == NULL) return -1;
+	asBase.size = fread(asBase.data, 1, h.size, f) == h.size ? h.size : 0;
+	fclose(f);
+	if (asBase.size == 0) return -1;
+	asBaseId = h.base;
+
+	if (asDelta.data == NULL || asDelta.alloc < asBase.alloc) {
+		free(asDelta.data);
+		asDelta.data = (unsigned char *) memalign(32, asBase.alloc);
+		asDelta.alloc = asDelta.data ? asBase.alloc : 0;
+	}
+	f = asDelta.data ? autoStateOpen("dlt", &h, asDelta.alloc) : NULL;
+	if (f != NULL) {
+		if (h.base == asBaseId && fread(asDelta.data, 1, h.size, f) == h.size) {
+			memcpy(asDelta.dirty, h.dirty, sizeof(asDelta.dirty));
+			asDelta.size = h.size;
+			asDelta.spuSize = h.spuSize;
+			ret = LoadStateDelta(&asBase, &asDelta);
+		}
+		fclose(f);
+	}
+	if (ret == -1) ret = LoadStateMem(&asBase);
+	asFrames = 0;
+	RewindReset();
+
+	if (ret == 0) SysPrintf("Resumed from the autosave of %.9s\n", CdromId);
+	return ret;
+}
+
+void AutoStateShutdown() {
+	StateMemFree(&asBase);
+	StateDeltaFree(&asDelta);
+	asFrames = 0;
+}
+
 // NET Function Helpers
 
 int SendPcsxInfo() {
@@ -539,6 +1529,7 @@ int SendPcsxInfo() {
 	NET_sendData(&Config.SpuIrq, sizeof(Config.SpuIrq), PSE_NET_BLOCKING);
 	NET_sendData(&Config.RCntFix, sizeof(Config.RCntFix), PSE_NET_BLOCKING);
 	NET_sendData(&Config.PsxType, sizeof(Config.PsxType), PSE_NET_BLOCKING);
+	NET_sendData(&Config.CdrSpeedup, sizeof(Config.CdrSpeedup), PSE_NET_BLOCKING);
 	NET_sendData(&Config.Cpu, sizeof(Config.Cpu), PSE_NET_BLOCKING);
 
 //	SysPrintf("Send OK\n");
@@ -559,6 +1550,7 @@ int RecvPcsxInfo() {
 	NET_recvData(&Config.SpuIrq, sizeof(Config.SpuIrq), PSE_NET_BLOCKING);
 	NET_recvData(&Config.RCntFix, sizeof(Config.RCntFix), PSE_NET_BLOCKING);
 	NET_recvData(&Config.PsxType, sizeof(Config.PsxType), PSE_NET_BLOCKING);
+	NET_recvData(&Config.CdrSpeedup, sizeof(Config.CdrSpeedup), PSE_NET_BLOCKING);
 	psxUpdateVSyncRate();
 
 	SysUpdate();
@@ -61,6 +61,42 @@ int Load(char *ExePath);
 int SaveState(char *file);
 int LoadState(char *file);
 int CheckState(char *file);
+int LoadStateBegin(char *file);
+int SaveStateWait();
+int LoadBiosState();
+void SaveBiosState();
+
+typedef struct {
+	unsigned char *data;
+	long size;		/* bytes used by the last SaveStateMem */
+	long alloc;
+	long spuSize;
+} StateMem;
+
+int StateMemInit(StateMem *st);
+void StateMemFree(StateMem *st);
+int SaveStateMem(StateMem *st);
+int LoadStateMem(StateMem *st);
+int SnapStateMem(StateMem *st);
+int RestoreStateMem(StateMem *st);
+int RestoreStateMemPages(StateMem *st, u32 *dirty);
+
+typedef struct {
+	u32 dirty[PSXMEM_PAGES / 32];	/* the pages kept, in order, before the rest */
+	int pages;
+	unsigned char *data;
+	long size;
+	long alloc;
+	long spuSize;
+} StateDelta;
+
+int SaveStateDelta(StateMem *base, StateDelta *d);
+int LoadStateDelta(StateMem *base, StateDelta *d);
+void StateDeltaFree(StateDelta *d);
+
+void AutoStateFrame();
+int LoadAutoState();
+void AutoStateShutdown();
 
 int SendPcsxInfo();
 int RecvPcsxInfo();
@@ -0,0 +1,275 @@
+/***************************************************************************
+ *   Copyright (C) 2007 Ryan Schultz, PCSX-df Team, PCSX team              *
+ *   schultz.ryan@gmail.com, http://rschultz.ath.cx/code.php               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+/*
+* Input movies: the pad data of every poll, with the frame it came in,
+* from power-on or from a save state kept next to the movie (.sta).
+* A replay feeds the same data to the same polls. For it to come out
+* bit-exact, what hangs on host timing is switched off while a movie
+* runs: frame skipping, the spu's sound buffer checks (it runs in sync
+* mode), the XA decode thread and run-ahead. Replays don't limit the
+* frame rate either, so they run as fast as the host allows and give
+* the time taken at the end. The memory cards are not part of a movie.
+*/
+
+#include <sys/time.h>
+
+#include "Movie.h"
+#include "Misc.h"
+#include "Rewind.h"
+
+#define MOVIE_MAGIC		"PCSXMOV"
+#define MOVIE_VERSION	1
+#define MOVIE_FROMSTATE	1
+
+typedef struct {
+	char magic[8];
+	u32 version;		/* all u32 are little endian */
+	u32 flags;
+	u32 frames;
+	u32 polls;
+	u32 reserved[2];
+} MovieHeader;
+
+typedef struct {
+	u32 frame;
+	u8 port;
+	u8 controllerType;
+	u16 buttonStatus;
+	u8 rightJoyX, rightJoyY, leftJoyX, leftJoyY;
+	u8 moveX, moveY;
+	u8 reserved[2];
+} MoviePoll;
+
+int movieMode = MOVIE_OFF;
+
+static MovieHeader mvHeader;
+static MoviePoll *mvPolls;
+static u32 mvAlloc, mvPos, mvFrame;
+static char mvFile[MAXPATHLEN];
+static long mvRunAhead;
+static u32 mvStart;
+static int mvDone;
+
+#ifdef __GAMECUBE__
+extern long long gettime(void);
+extern unsigned int diff_usec(long long start, long long end);
+#endif
+
+static u32 movieNow() {
+#ifdef __GAMECUBE__
+	return diff_usec(0, gettime()) / 1000;
+#else
+	struct timeval tv;
+
+	gettimeofday(&tv, 0);
+	return tv.tv_sec * 1000 + tv.tv_usec / 1000;
+#endif
+}
+
+static void movieStatePath(char *path) {
+	snprintf(path, MAXPATHLEN, "%s.sta", mvFile);
+}
+
+static void movieEnd() {
+	GPU_setDeterministic(0);
+	SPU_setDeterministic(0);
+	Config.RunAhead = mvRunAhead;
+	movieMode = MOVIE_OFF;
+
+	free(mvPolls);
+	mvPolls = NULL;
+	mvAlloc = mvPos = 0;
+}
+
+// the emulation from here on only hangs on the movie; here starts it
+// where the emulation is instead of at the movie's start
+static int movieBegin(int mode, int here) {
+	char path[MAXPATHLEN];
+
+	mvRunAhead = Config.RunAhead;
+	Config.RunAhead = 0;
+	GPU_setDeterministic(mode == MOVIE_PLAY ? 2 : 1);
+	SPU_setDeterministic(1);
+
+	if (here) {
+		// nothing to load
+	} else if (mvHeader.flags & MOVIE_FROMSTATE) {
+		movieStatePath(path);
+		if (mode == MOVIE_RECORD) {
+			if (SaveState(path) == -1 || SaveStateWait() != 0) goto fail;
+		}
+		if (LoadState(path) == -1) goto fail;
+	} else {
+		SysReset();
+		CheckCdrom();
+		LoadCdrom();
+	}
+	// a rewind state from before the movie would take it off its inputs
+	RewindReset();
+
+	movieMode = mode;
+	mvDone = 0;
+	mvPos = 0;
+	mvFrame = 0;
+	mvStart = movieNow();
+	return 0;
+
+fail:
+	SysPrintf("Movie: can't use the state %s\n", path);
+	movieEnd();
+	return -1;
+}
+
+int MovieRecord(char *file, int fromState) {
+	MovieStop();
+
+	strncpy(mvFile, file, MAXPATHLEN - 1);
+	memset(&mvHeader, 0, sizeof(mvHeader));
+	strcpy(mvHeader.magic, MOVIE_MAGIC);
+	mvHeader.version = SWAPu32(MOVIE_VERSION);
+	mvHeader.flags = fromState ? MOVIE_FROMSTATE : 0;
+
+	return movieBegin(MOVIE_RECORD, 0);
+}
+
+static int moviePlay(char *file, int here) {
+	FILE *f;
+	u32 n;
+
+	MovieStop();
+
+	f = fopen(file, "rb");
+	if (f == NULL) return -1;
+
+	if (fread(&mvHeader, sizeof(mvHeader), 1, f) != 1 ||
+		strcmp(mvHeader.magic, MOVIE_MAGIC) || SWAPu32(mvHeader.version) != MOVIE_VERSION) {
+		fclose(f);
+		return -1;
+	}
+	mvHeader.flags = SWAPu32(mvHeader.flags);
+	n = SWAPu32(mvHeader.polls);
+
+	mvPolls = (MoviePoll *) malloc(n * sizeof(MoviePoll) + 1);
+	if (mvPolls == NULL || fread(mvPolls, sizeof(MoviePoll), n, f) != n) {
+		fclose(f);
+		free(mvPolls);
+		mvPolls = NULL;
+		return -1;
+	}
+	fclose(f);
+	mvAlloc = n;
+
+	strncpy(mvFile, file, MAXPATHLEN - 1);
+	return movieBegin(MOVIE_PLAY, here);
+}
+
+int MoviePlay(char *file) {
+	return moviePlay(file, 0);
+}
+
+// plays the polls on from the current state, as input script
+int MoviePlayHere(char *file) {
+	return moviePlay(file, 1);
+}
+
+static void movieWrite() {
+	FILE *f;
+
+	mvHeader.flags = SWAPu32(mvHeader.flags);
+	mvHeader.frames = SWAPu32(mvFrame);
+	mvHeader.polls = SWAPu32(mvPos);
+
+	f = fopen(mvFile, "wb");
+	if (f == NULL ||
+		fwrite(&mvHeader, sizeof(mvHeader), 1, f) != 1 ||
+		fwrite(mvPolls, sizeof(MoviePoll), mvPos, f) != mvPos)
+		SysPrintf("Movie: can't write %s\n", mvFile);
+	if (f != NULL) fclose(f);
+}
+
+void MovieStop() {
+	u32 ms;
+
+	if (movieMode == MOVIE_RECORD) movieWrite();
+	if (movieMode == MOVIE_PLAY) {
+		ms = movieNow() - mvStart;
+		SysPrintf("Movie: %d frames in %d ms, %d fps\n", mvFrame, ms,
+			ms ? (int)((u64)mvFrame * 1000 / ms) : 0);
+	}
+
+	if (movieMode != MOVIE_OFF) movieEnd();
+}
+
+// called at every pad poll, before the pad data is used
+void MoviePad(int port, PadDataS *pad) {
+	MoviePoll *p;
+
+	if (movieMode == MOVIE_RECORD) {
+		if (mvPos == mvAlloc) {
+			p = (MoviePoll *) realloc(mvPolls, (mvAlloc + 4096) * sizeof(MoviePoll));
+			if (p == NULL) { MovieStop(); return; }
+			mvPolls = p;
+			mvAlloc += 4096;
+		}
+		p = &mvPolls[mvPos++];
+		memset(p, 0, sizeof(MoviePoll));
+		p->frame = SWAPu32(mvFrame);
+		p->port = port;
+		p->controllerType = pad->controllerType;
+		p->buttonStatus = SWAPu16(pad->buttonStatus);
+		p->rightJoyX = pad->rightJoyX; p->rightJoyY = pad->rightJoyY;
+		p->leftJoyX = pad->leftJoyX; p->leftJoyY = pad->leftJoyY;
+		p->moveX = pad->moveX; p->moveY = pad->moveY;
+		return;
+	}
+
+	if (movieMode != MOVIE_PLAY) return;
+
+	if (mvPos == mvAlloc) { MovieStop(); return; }
+	p = &mvPolls[mvPos++];
+	if (SWAPu32(p->frame) != mvFrame || p->port != port) {
+		SysPrintf("Movie: out of sync at frame %d\n", mvFrame);
+		MovieStop();
+		return;
+	}
+	pad->controllerType = p->controllerType;
+	pad->buttonStatus = SWAPu16(p->buttonStatus);
+	pad->rightJoyX = p->rightJoyX; pad->rightJoyY = p->rightJoyY;
+	pad->leftJoyX = p->leftJoyX; pad->leftJoyY = p->leftJoyY;
+	pad->moveX = p->moveX; pad->moveY = p->moveY;
+}
+
+// called every vsync
+void MovieFrame() {
+	if (movieMode == MOVIE_OFF) return;
+
+	mvFrame++;
+	if (movieMode == MOVIE_PLAY && mvFrame >= SWAPu32(mvHeader.frames)) {
+		mvDone = 1;
+		MovieStop();
+	}
+}
+
+// 1 when the last replay got to its end in sync
+int MovieDone() {
+	return mvDone;
+}
@@ -0,0 +1,42 @@
+/***************************************************************************
+ *   Copyright (C) 2007 Ryan Schultz, PCSX-df Team, PCSX team              *
+ *   schultz.ryan@gmail.com, http://rschultz.ath.cx/code.php               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#ifndef __MOVIE_H__
+#define __MOVIE_H__
+
+#include "PsxCommon.h"
+#include "plugins.h"
+
+#define MOVIE_OFF		0
+#define MOVIE_RECORD	1
+#define MOVIE_PLAY		2
+
+extern int movieMode;
+
+int  MovieRecord(char *file, int fromState);
+int  MoviePlay(char *file);
+int  MoviePlayHere(char *file);
+void MovieStop();
+void MoviePad(int port, PadDataS *pad);
+void MovieFrame();
+int  MovieDone();
+
+#endif /* __MOVIE_H__ */
@@ -19,6 +19,14 @@
 //*************************************************************************// 
 // History of changes:
 //
+// 2026/10/19 - pcsxgc
+// - added GPUsetDeterministic: frames are never skipped, in mode 2 the
+//   frame rate isn't waited for either (input movies)
+//
+// 2026/10/19 - pcsxgc
+// - added GPUsetOutput: while it is off, updateLace neither shows the
+//   frame nor waits for the frame rate (run-ahead frames)
+//
 // 2008/05/17 - Pete  
 // - added GPUvisualVibration and "visual rumble" stuff
 //
@@ -939,6 +947,8 @@ void CALLBACK GPUcursor(int iPlayer,int x,int y)
 // update lace is called evry VSync
 ////////////////////////////////////////////////////////////////////////
 
+static int iGPUOutput=1;                               // frames are shown
+
 #ifndef __GX__
 void CALLBACK GPUupdateLace(void)                      // VSYNC
 #else //!__GX__
@@ -954,6 +964,12 @@ void PEOPS_GPUupdateLace(void)
  if(!(dwActFixes&1))
   lGPUstatusRet^=0x80000000;                           // odd/even bit
 
+ if(!iGPUOutput)                                       // frame not shown?
+  {
+   bDoVSyncUpdate=FALSE;                               // -> just vsync done
+   return;
+  }
+
  if(!(dwActFixes&32))                                  // std fps limitation?
   CheckFrameRate();
 
@@ -992,6 +1008,53 @@ if(RECORD_RECORDING)
  bDoVSyncUpdate=FALSE;                                 // vsync done
 }
 
+////////////////////////////////////////////////////////////////////////
+// output on/off: the core emulates frames nobody sees (run-ahead)
+////////////////////////////////////////////////////////////////////////
+
+#ifndef __GX__
+void CALLBACK GPUsetOutput(int iOn)
+#else //!__GX__
+void PEOPS_GPUsetOutput(int iOn)
+#endif //__GX__
+{
+ iGPUOutput=iOn;
+}
+
+////////////////////////////////////////////////////////////////////////
+// deterministic timing: 1 never skips a frame, 2 doesn't limit the
+// frame rate either, 0 goes back to the configured skip/limit
+////////////////////////////////////////////////////////////////////////
+
+static int iCfgFrameLimit=-1,iCfgFrameSkip,iCfgFastFwd;
+
+#ifndef __GX__
+void CALLBACK GPUsetDeterministic(int iMode)
+#else //!__GX__
+void PEOPS_GPUsetDeterministic(int iMode)
+#endif //__GX__
+{
+ if(iCfgFrameLimit<0)                                  // first switch? keep the config
+  {
+   iCfgFrameLimit=UseFrameLimit;
+   iCfgFrameSkip=UseFrameSkip;
+   iCfgFastFwd=iFastFwd;
+  }
+
+ if(!iMode)                                            // back to the config
+  {
+   UseFrameLimit=iCfgFrameLimit;
+   UseFrameSkip=iCfgFrameSkip;
+   iFastFwd=iCfgFastFwd;
+   iCfgFrameLimit=-1;
+   return;
+  }
+
+ UseFrameSkip=0;iFastFwd=0;                            // a skipped frame isn't drawn to vram
+ bSkipNextFrame=FALSE;
+ UseFrameLimit=(iMode==2)?0:iCfgFrameLimit;
+}
+
 ////////////////////////////////////////////////////////////////////////
 // process read request from GPU status register
 ////////////////////////////////////////////////////////////////////////
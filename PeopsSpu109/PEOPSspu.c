@@ -19,6 +19,28 @@
 //*************************************************************************//
 // History of changes:
 //
+// 2026/10/19 - pcsxgc
+// - added SPUsetDeterministic: while it is on, the spu runs in sync mode,
+//   whatever the sound buffer is doing (input movies)
+//
+// 2026/10/19 - pcsxgc
+// - added SPUsetOutput: while it is off (run-ahead frames) nothing is
+//   sent to the sound device and the XA/CD audio streams are left alone,
+//   switching it on again goes on with the mix where it was switched off
+// - freezes keep the mix state (sync cycles, unfed samples) instead of
+//   resetting it with the timer
+//
+// 2026/10/19 - pcsxgc
+// - added SPUplayCDDAchannel: cd audio is mixed after XA with the cd volume
+//
+// 2026/10/19 - pcsxgc
+// - gauss/cubic interpolation works on runs: all output samples between
+//   two source samples are computed in one loop over the filter phases
+//
+// 2026/10/19 - pcsxgc
+// - added sync mode (iUseTimer 3): SPUasync renders exactly the samples
+//   owed for the passed psx cycles, no sound buffer checks, no waits
+//
 // 2004/09/19 - Pete
 // - added option: IRQ handling in the decoded sound buffer areas (Crash Team Racing)
 //
@@ -140,6 +162,7 @@ unsigned char * pMixIrq=0;
 // user settings          
 
 int             iUseXA=1;
+int             iSPUOutput=1;                          // sound goes out
 int             iVolume=3;
 int             iXAPitch=1;
 int             iUseTimer=2;
@@ -509,6 +532,55 @@ INLINE int iGetInterpolationVal(SPUCHAN * pChannel)
  return fa;
 }
 
+////////////////////////////////////////////////////////////////////////
+// POLYPHASE INTERPOLATION (gauss/cubic modes)
+//
+// The gauss table is a polyphase filter: 256 phases of 4 taps each,
+// interleaved. Between two new source samples the 4 sample history of
+// a channel doesn't change, only the phase (spos) does, by sinc per
+// output sample. So InterpolateRun computes all output samples of such
+// a run in one loop: the history stays in regs, and the loop walks the
+// table rows at the run's phase step. The main loop then just takes
+// them one by one. Same results as iGetInterpolationVal.
+////////////////////////////////////////////////////////////////////////
+
+INLINE int InterpolateRun(SPUCHAN * pChannel,int * out,int n)
+{
+ const int gpos=pChannel->SB[28];
+ const int h0=gval0,h1=gval(1),h2=gval(2),h3=gval(3);
+ const int sinc=pChannel->sinc;
+ int spos=pChannel->spos,k;
+
+ if(iUseInterpolation==2)                              // gauss: a dot product per phase
+  {
+   for(k=0;k<n && spos<0x10000L;k++,spos+=sinc)
+    {
+     const int * g=&gauss[(spos >> 6) & ~3];
+     out[k]=(((g[0]*h0)&~2047)+((g[1]*h1)&~2047)+
+             ((g[2]*h2)&~2047)+((g[3]*h3)&~2047))>>11;
+    }
+   return k;
+  }
+
+ for(k=0;k<n && spos<0x10000L;k++,spos+=sinc)          // cubic
+  {
+   const long xd = (spos >> 1)+1;
+   int fa;
+
+   fa  = h3 - 3*h2 + 3*h1 - h0;
+   fa *= (xd - (2<<15)) / 6;
+   fa >>= 15;
+   fa += h2 - h1 - h1 + h0;
+   fa *= (xd - (1<<15)) >> 1;
+   fa >>= 15;
+   fa += h1 - h0;
+   fa *= xd;
+   fa >>= 15;
+   out[k]=fa + h0;
+  }
+ return k;
+}
+
 ////////////////////////////////////////////////////////////////////////
 // MAIN SPU FUNCTION
 // here is the main job handler... thread, timer or direct func call
@@ -537,6 +609,7 @@ static void *MAINThread(void *arg)
  unsigned char * start;unsigned int nSample;
  int ch,predict_nr,shift_factor,flags,d,s;
  int bIRQReturn=0;SPUCHAN * pChannel;
+ int iRun[NSSIZE],iRunLen=0,iRunPos=0,iRunSinc=0;      // output samples of the current interpolation run
                             
  //while(!bEndThread)                                    // until we are shutting down
  // {
@@ -557,6 +630,7 @@ static void *MAINThread(void *arg)
    else iSecureStart=0;                                // 0: no new channel should start
 
    while(!iSecureStart && !bEndThread &&               // no new start? no thread end?
+         iUseTimer!=3 &&                               // no sync mode (there the core decides)?
          (SoundGetBytesBuffered()>TESTSIZE))           // and still enuff data in sound buffer?
     {
      iSecureStart=0;                                   // reset secure
@@ -605,7 +679,7 @@ static void *MAINThread(void *arg)
        if(pChannel->iActFreq!=pChannel->iUsedFreq)     // new psx frequency?
         VoiceChangeFrequency(pChannel);
 
-       ns=0;
+       ns=0;iRunLen=0;
        while(ns<NSSIZE)                                // loop until 1 ms of data is reached
         {
          if(pChannel->bFMod==1 && iFMod[ns])           // fmod freq channel
@@ -709,7 +783,7 @@ static void *MAINThread(void *arg)
              if(bIRQReturn)                            // special return for "spu irq - wait for cpu action"
               {
                bIRQReturn=0;
-               if(iUseTimer!=2)
+               if(iUseTimer<2)
                 { 
                  DWORD dwWatchTime=timeGetTime()+2500;
 
@@ -744,6 +818,7 @@ GOON: ;
            fa=pChannel->SB[pChannel->iSBPos++];        // get sample data
 
            StoreInterpolationVal(pChannel,fa);         // store val for later interpolation
+           iRunLen=0;                                  // -> new interpolation run
 
            pChannel->spos -= 0x10000L;
           }
@@ -752,6 +827,17 @@ GOON: ;
                                 
          if(pChannel->bNoise)
               fa=iGetNoiseVal(pChannel);               // get noise val
+         else
+         if((iUseInterpolation==2 || iUseInterpolation==3) &&
+            pChannel->bFMod!=2)                        // gauss/cubic: same history until the next source sample
+          {
+           if(iRunPos>=iRunLen || pChannel->sinc!=iRunSinc) // new run, or fmod changed the step
+            {
+             iRunLen=InterpolateRun(pChannel,iRun,NSSIZE-ns);
+             iRunPos=0;iRunSinc=pChannel->sinc;
+            }
+           fa=iRun[iRunPos++];
+          }
          else fa=iGetInterpolationVal(pChannel);       // get sample val
 
          pChannel->sval=(MixADSR(pChannel)*fa)/1023;   // mix adsr
@@ -793,7 +879,16 @@ ENDX:   ;
   //---------------------------------------------------//
   // mix XA infos (if any)
 
-  if(XAPlay!=XAFeed || XARepeat) MixXA();
+  if(iSPUOutput)                                       // streams only play in shown frames
+   {
+    if(XAPlay!=XAFeed || XARepeat) MixXA();
+    if(CDDAPlay!=CDDAFeed) MixCDDA();
+   }
+
+  ///////////////////////////////////////////////////////
+  // mix the reverb of the whole tick
+
+  MixREVERBBlock();
 
   ///////////////////////////////////////////////////////
   // mix all channels (including reverb) into one buffer
@@ -803,12 +898,8 @@ ENDX:   ;
     int dl,dr;
     for(ns=0;ns<NSSIZE;ns++)
      {            
-      SSumL[ns]+=MixREVERBLeft(ns);
-                                              
       dl=SSumL[ns]/voldiv;SSumL[ns]=0;
       if(dl<-32767) dl=-32767;if(dl>32767) dl=32767;
-        
-      SSumR[ns]+=MixREVERBRight();
 
       dr=SSumR[ns]/voldiv;SSumR[ns]=0;
       if(dr<-32767) dr=-32767;if(dr>32767) dr=32767;
@@ -818,13 +909,9 @@ ENDX:   ;
   else                                                 // stereo:
   for(ns=0;ns<NSSIZE;ns++)
    {            
-    SSumL[ns]+=MixREVERBLeft(ns);
-                                              
     d=SSumL[ns]/voldiv;SSumL[ns]=0;
     if(d<-32767) d=-32767;if(d>32767) d=32767;
     *pS++=d;
-        
-    SSumR[ns]+=MixREVERBRight();
 
     d=SSumR[ns]/voldiv;SSumR[ns]=0;
     if(d<-32767) d=-32767;if(d>32767) d=32767;
@@ -890,9 +977,10 @@ ENDX:   ;
 
     //-------------------------------------------------//
 
-    SoundFeedStreamData((unsigned char*)pSpuBuffer,
-                        ((unsigned char *)pS)-
-                        ((unsigned char *)pSpuBuffer));
+    if(iSPUOutput)
+     SoundFeedStreamData((unsigned char*)pSpuBuffer,
+                         ((unsigned char *)pS)-
+                         ((unsigned char *)pSpuBuffer));
     pS=(short *)pSpuBuffer;
     iCycle=0;
    }
@@ -925,6 +1013,30 @@ DWORD WINAPI MAINThreadEx(LPVOID lpParameter)
 ////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////
 
+////////////////////////////////////////////////////////////////////////
+// SYNC MODE: the core tells us how many psx cycles have passed, and we
+// render exactly the samples owed for them (in NSSIZE ticks). What is
+// left (less than one tick) is kept for the next call, so the sound
+// never drifts from the emulated time. No sound buffer checks, no waits.
+////////////////////////////////////////////////////////////////////////
+
+#define SYNC_CYCLES_PER_SAMPLE 768                     // 33868800 Hz psx clock / 44100 Hz
+#define SYNC_CYCLES_PER_TICK   (SYNC_CYCLES_PER_SAMPLE*NSSIZE)
+
+static unsigned long dwSyncCycles=0;                   // psx cycles we still owe sound for
+
+static void SyncSPU(unsigned long cycle)
+{
+ dwSyncCycles+=cycle;
+
+ while(dwSyncCycles>=SYNC_CYCLES_PER_TICK && !bEndThread)
+  {
+   MAINThread(0);                                      // -> one tick
+   if(lastch>=0) break;                                // -> spu irq wait: tick is not done yet, the cpu will run until the next sync first
+   dwSyncCycles-=SYNC_CYCLES_PER_TICK;
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////
 // SPU ASYNC... even newer epsxe func
 //  1 time every 'cycle' cycles... harhar
@@ -932,6 +1044,14 @@ DWORD WINAPI MAINThreadEx(LPVOID lpParameter)
 
 void CALLBACK PEOPS_SPUasync(unsigned long cycle)
 {
+ if(iUseTimer==3)                                      // sync mode: no async wait handshake needed
+  {
+   if(!bSpuInit) return;
+   iSpuAsyncWait=0;
+   SyncSPU(cycle);
+   return;
+  }
+
 
  if(iSpuAsyncWait)
   {
@@ -993,12 +1113,122 @@ void CALLBACK PEOPS_SPUupdate(void)
 void CALLBACK PEOPS_SPUplayADPCMchannel(xa_decode_t *xap)
 {
  if(!iUseXA)    return;                                // no XA? bye
+ if(!iSPUOutput) return;                               // not played anyway
  if(!xap)       return;
  if(!xap->freq) return;                                // no xa freq ? bye
 
  FeedXA(xap);                                          // call main XA feeder
 }
 
+////////////////////////////////////////////////////////////////////////
+// MIX KEEP: what the mixer owes the sound device (sync cycles, the half
+// mixed tick, the samples not fed yet) is no psx state. Freezes and
+// run-ahead frames must not reset or advance it.
+////////////////////////////////////////////////////////////////////////
+
+typedef struct
+{
+ unsigned long dwSyncCycles;
+ int iCycle;
+ int iBytes;                                           // of pSpuBuffer not fed yet
+ int SSumL[NSSIZE];
+ int SSumR[NSSIZE];
+ int iFMod[NSSIZE];
+} MIXKEEP;
+
+static MIXKEEP mkFreeze,mkOutput;
+static unsigned char cKeepBuffer[18*NSSIZE*4];          // 17+1 stereo ticks till the feed
+
+static void KeepMix(MIXKEEP * pK)
+{
+ pK->dwSyncCycles=dwSyncCycles;
+ pK->iCycle=iCycle;
+ pK->iBytes=pSpuBuffer?((unsigned char *)pS)-pSpuBuffer:0;
+ memcpy(pK->SSumL,SSumL,NSSIZE*sizeof(int));
+ memcpy(pK->SSumR,SSumR,NSSIZE*sizeof(int));
+ memcpy(pK->iFMod,iFMod,NSSIZE*sizeof(int));
+}
+
+static void RestoreMix(MIXKEEP * pK)
+{
+ dwSyncCycles=pK->dwSyncCycles;
+ iCycle=pK->iCycle;
+ if(pSpuBuffer) pS=(short *)(pSpuBuffer+pK->iBytes);
+ memcpy(SSumL,pK->SSumL,NSSIZE*sizeof(int));
+ memcpy(SSumR,pK->SSumR,NSSIZE*sizeof(int));
+ memcpy(iFMod,pK->iFMod,NSSIZE*sizeof(int));
+}
+
+// freezes stop the timer but keep the mix going where it was
+void PauseTimer(void)
+{
+ KeepMix(&mkFreeze);
+ RemoveTimer();
+}
+
+void ResumeTimer(void)
+{
+ SetupTimer();
+ RestoreMix(&mkFreeze);
+}
+
+////////////////////////////////////////////////////////////////////////
+// OUTPUT ON/OFF: the core emulates frames nobody hears (run-ahead)
+////////////////////////////////////////////////////////////////////////
+
+void CALLBACK PEOPS_SPUsetOutput(int iOn)
+{
+ if(!iOn==!iSPUOutput) return;
+
+ if(!iOn)                                              // silent frames follow:
+  {
+   KeepMix(&mkOutput);                                 // -> keep what the shown ones left
+   if(mkOutput.iBytes>(int)sizeof(cKeepBuffer)) mkOutput.iBytes=sizeof(cKeepBuffer);
+   if(pSpuBuffer) memcpy(cKeepBuffer,pSpuBuffer,mkOutput.iBytes);
+  }
+ else                                                  // shown again: go on from there
+  {
+   RestoreMix(&mkOutput);
+   if(pSpuBuffer) memcpy(pSpuBuffer,cKeepBuffer,mkOutput.iBytes);
+  }
+
+ iSPUOutput=iOn;
+}
+
+////////////////////////////////////////////////////////////////////////
+// DETERMINISTIC ON/OFF: the spu timing may only hang on the psx cycles
+////////////////////////////////////////////////////////////////////////
+
+static int iCfgUseTimer=-1;
+
+void CALLBACK PEOPS_SPUsetDeterministic(int iOn)
+{
+ if(iOn)
+  {
+   if(iCfgUseTimer<0) iCfgUseTimer=iUseTimer;          // keep the configured mode
+   iUseTimer=3;                                        // -> sync mode
+   dwSyncCycles=0;                                     // -> ticks start now
+  }
+ else if(iCfgUseTimer>=0)
+  {
+   iUseTimer=iCfgUseTimer;
+   iCfgUseTimer=-1;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// CDDA AUDIO
+////////////////////////////////////////////////////////////////////////
+
+long CALLBACK PEOPS_SPUplayCDDAchannel(short *pcm, int nbytes)
+{
+ if(!pcm)      return -1;
+ if(nbytes<=0) return -1;
+
+ if(FeedCDDA((unsigned char *)pcm,nbytes)) return -1;  // full: play some first
+ return 0;
+}
+
 ////////////////////////////////////////////////////////////////////////
 // INIT/EXIT STUFF
 ////////////////////////////////////////////////////////////////////////
@@ -1023,6 +1253,7 @@ long CALLBACK PEOPS_SPUinit(void)
 void SetupTimer(void)
 {
   
+ dwSyncCycles=0;                                       // nothing owed in sync mode
  memset(SSumR,0,NSSIZE*sizeof(int));                   // init some mixing buffers
  memset(SSumL,0,NSSIZE*sizeof(int));
  memset(iFMod,0,NSSIZE*sizeof(int));
@@ -1121,6 +1352,12 @@ void SetupStreams(void)
  XAFeed  = XAStart;
  XAEnd   = XAStart + 44100;
 
+ CDDAStart =                                           // alloc cdda buffer: a few
+  (unsigned long *)malloc(CDDA_BUFFER*4);              // sectors, so volume changes
+ CDDAPlay  = CDDAStart;                                // and stops are heard soon
+ CDDAFeed  = CDDAStart;
+ CDDAEnd   = CDDAStart + CDDA_BUFFER;
+
  for(i=0;i<MAXCHAN;i++)                                // loop sound channels
   {
 // we don't use mutex sync... not needed, would only 
@@ -1149,6 +1386,8 @@ void RemoveStreams(void)
  sRVBStart=0;
  free(XAStart);                                        // free XA buffer
  XAStart=0;
+ free(CDDAStart);                                      // free CDDA buffer
+ CDDAStart=0;
 
 /*
  int i;
@@ -1244,7 +1483,7 @@ long CALLBACK PEOPS_SPUclose(void)
 {
  if(!bSPUIsOpen) return 0;                             // some security
 
- bSPUIsOpen=0;                                         // no more open
+ bSPUIsOpen=0;                                         // no more open, FeedCDDA stops here
 
 #ifdef _WINDOWS
  if(IsWindow(hWDebug)) DestroyWindow(hWDebug);
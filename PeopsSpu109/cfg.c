@@ -19,6 +19,10 @@
 //*************************************************************************//
 // History of changes:
 //
+// 2026/10/19 - pcsxgc
+// - SoundLatency sets the ms of sound queued with THREADED_AUDIO
+// - HighCompMode=3 selects the new sync mode (also with NOTHREADLIB)
+//
 // 2003/06/07 - Pete
 // - added Linux NOTHREADLIB define
 //
@@ -444,10 +448,11 @@ void ReadConfigFile(void)
  if(iUseTimer<0) iUseTimer=0; 
  // note: timer mode 1 (win time events) is not supported
  // in linux. But timer mode 2 (spuupdate) is safe to use.
- if(iUseTimer)   iUseTimer=2; 
+ // Mode 3 (sync, driven by the emu's spuasync cycles) is safe as well.
+ if(iUseTimer && iUseTimer!=3) iUseTimer=2; 
 
 #ifdef NOTHREADLIB
- iUseTimer=2; 
+ if(iUseTimer!=3) iUseTimer=2; 
 #endif
 
  strcpy(t,"\nSPUIRQWait");p=strstr(pB,t);if(p) {p=strstr(p,"=");len=1;} 
@@ -475,6 +480,13 @@ void ReadConfigFile(void)
  if(iUseDBufIrq<0) iUseDBufIrq=0; 
  if(iUseDBufIrq>1) iUseDBufIrq=1; 
 
+#ifdef THREADED_AUDIO
+ strcpy(t,"\nSoundLatency");p=strstr(pB,t);if(p) {p=strstr(p,"=");len=1;} 
+ if(p)  iSoundLatency=atoi(p+len); 
+ if(iSoundLatency<20)  iSoundLatency=20; 
+ if(iSoundLatency>180) iSoundLatency=180;              // twice that has to fit the ring
+#endif
+
  free(pB);
 }
 
@@ -493,6 +505,9 @@ void ReadConfig(void)
  iUseInterpolation=2;
  iDisStereo=0;
  iUseDBufIrq=0;
+#ifdef THREADED_AUDIO
+ iSoundLatency=100;
+#endif
 
  ReadConfigFile();
 
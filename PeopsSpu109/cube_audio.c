@@ -11,6 +11,9 @@
  ***************************************************************************/
 
 #include "stdafx.h"
+
+#define _IN_CUBE_AUDIO
+
 #include "externals.h"
 #include "PsxCommon.h"
 
@@ -40,14 +43,29 @@ static enum { BUFFER_SIZE_32_60 = 2112, BUFFER_SIZE_32_50 = 2560 } buffer_size;
 
 #ifdef THREADED_AUDIO
 static lwp_t audio_thread;
-static sem_t buffer_full;
-static sem_t buffer_empty;
 static sem_t audio_free;
 static int   thread_running;
 #define AUDIO_STACK_SIZE 1024 // MEM: I could get away with a smaller stack
 static char  audio_stack[AUDIO_STACK_SIZE];
 #define AUDIO_PRIORITY 120
 static int   thread_buffer = 0;
+
+// Single producer (the SPU mixer) / single consumer (the audio thread)
+//   ring of mixed 44.1kHz samples. Only the mixer moves ring_head and
+//   only the audio thread moves ring_tail, so neither side ever waits:
+//   the mixer drops what doesn't fit (overrun), the audio thread plays
+//   silence for what isn't there yet (underrun).
+#define RING_SIZE 65536 // Must be a power of two, ~370ms of stereo
+#define RING_MASK (RING_SIZE-1)
+static char ring[RING_SIZE] __attribute__((aligned(32)));
+static volatile unsigned int ring_head = 0;
+static volatile unsigned int ring_tail = 0;
+// Linear copy of the ring for the resampler (one DMA buffer worth + 1 sample)
+static char ring_scratch[(int)(BUFFER_SIZE_32_50 * 44100 / 32000) + 8] __attribute__((aligned(32)));
+
+int iSoundLatency = 100;            // ms of mixed sound we queue at most
+unsigned long ulSoundUnderruns = 0; // DMA buffers (partially) filled with silence
+unsigned long ulSoundOverruns  = 0; // mixed blocks dropped because the ring was full
 #else // !THREADED_AUDIO
 #define thread_buffer which_buffer
 #endif
@@ -66,20 +84,20 @@ void SetupSound(void)
 {
   AUDIO_Init(NULL);
 
+	buffer_size = Config.PsxType ? BUFFER_SIZE_32_50 : BUFFER_SIZE_32_60;
+	AUDIO_SetDSPSampleRate(AI_SAMPLERATE_32KHZ);
+	copy_to_buffer = iDisStereo ? copy_to_buffer_mono : copy_to_buffer_stereo;
+
 #ifdef THREADED_AUDIO
-	// Create our semaphores and start/resume the audio thread; reset the buffer index
-	LWP_SemInit(&buffer_full, 0, NUM_BUFFERS);
-	LWP_SemInit(&buffer_empty, NUM_BUFFERS, NUM_BUFFERS);
+	// Empty the ring, create our semaphore and start/resume the audio thread; reset the buffer index
+	ring_head = ring_tail = 0;
+	ulSoundUnderruns = ulSoundOverruns = 0;
 	LWP_SemInit(&audio_free, 1, 1);
 	thread_running = 1;
-	LWP_CreateThread(&audio_thread, (void*)play_buffer, NULL, audio_stack, AUDIO_STACK_SIZE, AUDIO_PRIORITY);
-	AUDIO_RegisterDMACallback(done_playing);
 	thread_buffer = which_buffer = 0;
+	AUDIO_RegisterDMACallback(done_playing);
+	LWP_CreateThread(&audio_thread, (void*)play_buffer, NULL, audio_stack, AUDIO_STACK_SIZE, AUDIO_PRIORITY);
 #endif
-
-	buffer_size = Config.PsxType ? BUFFER_SIZE_32_50 : BUFFER_SIZE_32_60;
-	AUDIO_SetDSPSampleRate(AI_SAMPLERATE_32KHZ);
-	copy_to_buffer = iDisStereo ? copy_to_buffer_mono : copy_to_buffer_stereo;
 	//printf("SetupSound\n");
 }
 
@@ -92,12 +110,11 @@ void RemoveSound(void)
  AUDIO_StopDMA();
 
 #ifdef THREADED_AUDIO
-	// Destroy semaphores and suspend the thread so audio can't play
+	// Stop the thread (wake it if it's waiting on the DMA) so audio can't play
 	thread_running = 0;
-	LWP_SemDestroy(buffer_full);
-	LWP_SemDestroy(buffer_empty);
-	LWP_SemDestroy(audio_free);
+	LWP_SemPost(audio_free);
 	LWP_JoinThread(audio_thread, NULL);
+	LWP_SemDestroy(audio_free);
 #endif
 
  //DEBUG_print("RemoveSound called",12);
@@ -107,22 +124,67 @@ void RemoveSound(void)
 // GET BYTES BUFFERED
 ////////////////////////////////////////////////////////////////////////
 
+#ifdef THREADED_AUDIO
+// iSoundLatency in bytes of mixed (44.1kHz) sound
+static unsigned int latency_bytes(void)
+{
+	return (unsigned int)iSoundLatency * 441 / 10 << (iDisStereo ? 1 : 2);
+}
+#endif
+
 unsigned long SoundGetBytesBuffered(void)
 {
+#ifdef THREADED_AUDIO
+	// Everything mixed but not yet taken by the audio thread, scaled
+	//   so the mixer's TESTSIZE throttle kicks in at iSoundLatency
+	return (unsigned long)((ring_head - ring_tail) & RING_MASK) * TESTSIZE / latency_bytes();
+#else
  	/*sprintf(txtbuffer,"SoundGetBytesBuffered returns approx: %d bytes",
  	        buffer_size - AUDIO_GetDMABytesLeft());
  	DEBUG_print(txtbuffer,12);*/
  	if(!AUDIO_GetDMABytesLeft())
  	  return 0;
   return buffer_size - AUDIO_GetDMABytesLeft();
+#endif
 }
 
 #ifdef THREADED_AUDIO
 static void done_playing(void){
-	// We're done playing, so we're releasing a buffer and the audio
-	LWP_SemPost(buffer_empty);
+	// We're done playing, so we're releasing the audio
 	LWP_SemPost(audio_free);
 }
+
+static void fill_from_ring(void){
+	// Resample one DMA buffer worth out of the ring; never waits for the mixer
+	const int shift = iDisStereo ? 1 : 2;
+	const unsigned int head = ring_head;
+	unsigned int avail = ((head - ring_tail) & RING_MASK) >> shift;
+	unsigned int rlengthi = buffer_size >> shift;
+	unsigned int lengthi = rlengthi * freq_ratio;
+	unsigned int bytes, first;
+
+	if(avail < lengthi + 1){
+		// Not enough mixed data: play what we have, the rest is silence
+		++ulSoundUnderruns;
+		rlengthi = avail > 1 ? (avail - 1) * inv_freq_ratio : 0;
+		lengthi  = rlengthi * freq_ratio;
+		memset(buffer[thread_buffer] + (rlengthi << shift), 0,
+		       buffer_size - (rlengthi << shift));
+		if(!rlengthi) return;
+	}
+
+	// Copy out the samples needed by the interpolation (one past the last)
+	bytes = (lengthi + 1) << shift;
+	first = RING_SIZE - ring_tail;
+	if(first > bytes) first = bytes;
+	memcpy(ring_scratch, ring + ring_tail, first);
+	memcpy(ring_scratch + first, ring, bytes - first);
+
+	copy_to_buffer(buffer[thread_buffer], ring_scratch, rlengthi);
+
+	// Only now give the space back to the mixer
+	ring_tail = (ring_tail + (lengthi << shift)) & RING_MASK;
+}
 #endif
 
 static void inline play_buffer(void){
@@ -135,8 +197,8 @@ static void inline play_buffer(void){
 	// This thread will keep giving buffers to the audio as they come
 	while(thread_running){
 
-	// Wait for a buffer to be processed
-	LWP_SemWait(buffer_full);
+	// Take the next buffer worth of sound out of the ring
+	fill_from_ring();
 #endif
 
 	// Make sure the buffer is in RAM, not the cache
@@ -148,6 +210,7 @@ static void inline play_buffer(void){
 #ifdef THREADED_AUDIO
 	// Wait for the audio interface to be free before playing
 	LWP_SemWait(audio_free);
+	if(!thread_running) break;
 #endif
 
 	// Start playing the buffer
@@ -194,6 +257,31 @@ static void copy_to_buffer_stereo(void* b, void* s, unsigned int length){
 	}
 }
 
+#ifdef THREADED_AUDIO
+static void inline add_to_buffer(void* stream, unsigned int length){
+	// Just queue the mixed sound for the audio thread, this never blocks
+	const unsigned int head = ring_head;
+	// The mixer stops at iSoundLatency, this only catches what it
+	//   mixes past that (and sync mode, which never stops)
+	unsigned int latency = latency_bytes() * 2;
+	unsigned int first;
+
+	if(latency > RING_MASK) latency = RING_MASK;
+	if(((head - ring_tail) & RING_MASK) + length > latency){
+		// The audio thread is behind: drop this block instead of waiting
+		++ulSoundOverruns;
+		return;
+	}
+
+	first = RING_SIZE - head;
+	if(first > length) first = length;
+	memcpy(ring + head, stream, first);
+	memcpy(ring, (char*)stream + first, length - first);
+
+	// Only now hand the data to the audio thread
+	ring_head = (head + length) & RING_MASK;
+}
+#else // !THREADED_AUDIO
 static void inline add_to_buffer(void* stream, unsigned int length){
 	// This shouldn't lose any data and works for any size
 	unsigned int stream_offset = 0;
@@ -209,22 +297,11 @@ static void inline add_to_buffer(void* stream, unsigned int length){
 		            rlengthLeft : ((buffer_size - buffer_offset) >> shift);
 		lengthi  = rlengthi * freq_ratio;
 
-#ifdef THREADED_AUDIO
-		// Wait for a buffer we can copy into
-		LWP_SemWait(buffer_empty);
-#endif
 		copy_to_buffer(buffer[which_buffer] + buffer_offset,
 		               stream + stream_offset, rlengthi);
 
 		if(buffer_offset + (rlengthLeft << shift) < buffer_size){
 			buffer_offset += rlengthi << shift;
-#ifdef THREADED_AUDIO
-			// This is a little weird, but we didn't fill this buffer.
-			//   So it is still considered 'empty', but since we 'decremented'
-			//   buffer_empty coming in here, we want to set it back how
-			//   it was, so we don't cause a deadlock
-			LWP_SemPost(buffer_empty);
-#endif
 			return;
 		}
 
@@ -232,17 +309,13 @@ static void inline add_to_buffer(void* stream, unsigned int length){
 		stream_offset += lengthi << shift;
 		rlengthLeft   -= rlengthi;
 
-#ifdef THREADED_AUDIO
-		// Let the audio thread know that we've filled a new buffer
-		LWP_SemPost(buffer_full);
-#else
 		play_buffer();
-#endif
 
 		NEXT(which_buffer);
 		buffer_offset = 0;
 	}
 }
+#endif
 
 ////////////////////////////////////////////////////////////////////////
 // FEED SOUND DATA
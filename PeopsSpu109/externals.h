@@ -58,6 +58,9 @@
 // ~ 1 ms of data
 #define NSSIZE 45
 
+// cdda samples buffered, 8 sectors (~107 ms)
+#define CDDA_BUFFER (8*588)
+
 ///////////////////////////////////////////////////////////
 // struct defines
 ///////////////////////////////////////////////////////////
@@ -326,6 +329,11 @@ extern unsigned long   XALastVal;
 extern int           iLeftXAVol;
 extern int           iRightXAVol;
 
+extern unsigned long * CDDAFeed;
+extern unsigned long * CDDAPlay;
+extern unsigned long * CDDAStart;
+extern unsigned long * CDDAEnd;
+
 #endif
 
 ///////////////////////////////////////////////////////////
@@ -342,3 +350,17 @@ extern int            iReverbRepeat;
 extern int            iReverbNum;    
 
 #endif
+
+///////////////////////////////////////////////////////////
+// CUBE_AUDIO.C globals
+///////////////////////////////////////////////////////////
+
+#ifndef _IN_CUBE_AUDIO
+
+#ifdef THREADED_AUDIO
+extern int           iSoundLatency;
+extern unsigned long ulSoundUnderruns;
+extern unsigned long ulSoundOverruns;
+#endif
+
+#endif
@@ -95,7 +95,7 @@ long CALLBACK PEOPS_SPUfreeze(unsigned long ulFreezeMode,SPUFreeze_t * pF)
 
    if(ulFreezeMode==2) return 1;                       // info mode? ok, bye
                                                        // save mode:
-   RemoveTimer();                                      // stop timer
+   PauseTimer();                                       // stop timer, keep the mix
 
    memcpy(pF->cSPURam,spuMem,0x80000);                 // copy common infos
    memcpy(pF->cSPUPort,regArea,0x200);
@@ -123,7 +123,7 @@ long CALLBACK PEOPS_SPUfreeze(unsigned long ulFreezeMode,SPUFreeze_t * pF)
       pFO->s_chan[i].pLoop-=(unsigned long)spuMemC;
     }
 
-   SetupTimer();                                       // sound processing on again
+   ResumeTimer();                                      // sound processing on again
 
    return 1;
    //--------------------------------------------------//
@@ -138,7 +138,7 @@ long CALLBACK PEOPS_SPUfreeze(unsigned long ulFreezeMode,SPUFreeze_t * pF)
   return 0;
 #endif
 
- RemoveTimer();                                        // we stop processing while doing the save!
+ PauseTimer();                                         // we stop processing while doing the save!
 
  memcpy(spuMem,pF->cSPURam,0x80000);                   // get ram
  memcpy(regArea,pF->cSPUPort,0x200);
@@ -175,7 +175,7 @@ long CALLBACK PEOPS_SPUfreeze(unsigned long ulFreezeMode,SPUFreeze_t * pF)
    PEOPS_SPUwriteRegister(0x1f801c00+(i<<4)+0xca,regArea[(i<<3)+0x65]);
   }
 
- SetupTimer();                                         // start sound processing again
+ ResumeTimer();                                        // start sound processing again, the mix goes on
 
  return 1;
 }
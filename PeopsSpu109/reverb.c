@@ -19,6 +19,10 @@
 //*************************************************************************//
 // History of changes:
 //
+// 2026/10/19 - pcsxgc
+// - Neill's reverb is now mixed in blocks of a full tick (MixREVERBBlock),
+//   tap wraps are resolved once per block instead of on every access
+//
 // 2003/01/19 - Pete
 // - added Neill's reverb (see at the end of file)
 //
@@ -148,153 +152,273 @@ INLINE void StoreREVERB(SPUCHAN * pChannel,int ns)
 
 ////////////////////////////////////////////////////////////////////////
 
-INLINE int g_buffer(int iOff)                          // get_buffer content helper: takes care about wraps
+INLINE int rvb_wrap(int iOff)                          // wrap helper: maps a raw work area offset into the reverb area
 {
- short * p=(short *)spuMem;
- iOff=(iOff*4)+rvb.CurrAddr;
  while(iOff>0x3FFFF)       iOff=rvb.StartAddr+(iOff-0x40000);
  while(iOff<rvb.StartAddr) iOff=0x3ffff-(rvb.StartAddr-iOff);
- return (int)*(p+iOff);
+ return iOff;
 }
 
 ////////////////////////////////////////////////////////////////////////
 
-INLINE void s_buffer(int iOff,int iVal)                // set_buffer content helper: takes care about wraps and clipping
+INLINE short rvb_clip(int iVal)                        // clipping helper
 {
- short * p=(short *)spuMem;
- iOff=(iOff*4)+rvb.CurrAddr;
- while(iOff>0x3FFFF) iOff=rvb.StartAddr+(iOff-0x40000);
- while(iOff<rvb.StartAddr) iOff=0x3ffff-(rvb.StartAddr-iOff);
  if(iVal<-32768L) iVal=-32768L;if(iVal>32767L) iVal=32767L;
- *(p+iOff)=(short)iVal;
+ return (short)iVal;
 }
 
 ////////////////////////////////////////////////////////////////////////
 
-INLINE void s_buffer1(int iOff,int iVal)                // set_buffer (+1 sample) content helper: takes care about wraps and clipping
+INLINE int g_buffer(int iOff)                          // get_buffer content helper: takes care about wraps
 {
  short * p=(short *)spuMem;
- iOff=(iOff*4)+rvb.CurrAddr+1;
- while(iOff>0x3FFFF) iOff=rvb.StartAddr+(iOff-0x40000);
- while(iOff<rvb.StartAddr) iOff=0x3ffff-(rvb.StartAddr-iOff);
- if(iVal<-32768L) iVal=-32768L;if(iVal>32767L) iVal=32767L;
- *(p+iOff)=(short)iVal;
+ return (int)*(p+rvb_wrap((iOff*4)+rvb.CurrAddr));
 }
 
 ////////////////////////////////////////////////////////////////////////
 
-INLINE int MixREVERBLeft(int ns)
+INLINE void s_buffer(int iOff,int iVal)                // set_buffer content helper: takes care about wraps and clipping
 {
- if(iUseReverb==0) return 0;
- else
- if(iUseReverb==2)
-  {
-   static int iCnt=0;                                  // this func will be called with 44.1 khz
-
-   if(!rvb.StartAddr)                                  // reverb is off
-    {
-     rvb.iLastRVBLeft=rvb.iLastRVBRight=rvb.iRVBLeft=rvb.iRVBRight=0;
-     return 0;
-    }
+ short * p=(short *)spuMem;
+ *(p+rvb_wrap((iOff*4)+rvb.CurrAddr))=rvb_clip(iVal);
+}
 
-   iCnt++;                                    
+////////////////////////////////////////////////////////////////////////
 
-   if(iCnt&1)                                          // we work on every second left value: downsample to 22 khz
-    {
-     if(spuCtrl&0x80)                                  // -> reverb on? oki
-      {
-       int ACC0,ACC1,FB_A0,FB_A1,FB_B0,FB_B1;
+INLINE void s_buffer1(int iOff,int iVal)                // set_buffer (+1 sample) content helper: takes care about wraps and clipping
+{
+ short * p=(short *)spuMem;
+ *(p+rvb_wrap((iOff*4)+rvb.CurrAddr+1))=rvb_clip(iVal);
+}
 
-       const int INPUT_SAMPLE_L=*(sRVBStart+(ns<<1));                         
-       const int INPUT_SAMPLE_R=*(sRVBStart+(ns<<1)+1);                     
+////////////////////////////////////////////////////////////////////////
 
-       const int IIR_INPUT_A0 = (g_buffer(rvb.IIR_SRC_A0) * rvb.IIR_COEF)/32768L + (INPUT_SAMPLE_L * rvb.IN_COEF_L)/32768L;
-       const int IIR_INPUT_A1 = (g_buffer(rvb.IIR_SRC_A1) * rvb.IIR_COEF)/32768L + (INPUT_SAMPLE_R * rvb.IN_COEF_R)/32768L;
-       const int IIR_INPUT_B0 = (g_buffer(rvb.IIR_SRC_B0) * rvb.IIR_COEF)/32768L + (INPUT_SAMPLE_L * rvb.IN_COEF_L)/32768L;
-       const int IIR_INPUT_B1 = (g_buffer(rvb.IIR_SRC_B1) * rvb.IIR_COEF)/32768L + (INPUT_SAMPLE_R * rvb.IN_COEF_R)/32768L;
+INLINE short * b_buffer(int iOff,int iAdd,int iSteps)  // block helper: resolves the wrap of one tap for a whole block...
+{                                                      // ... returns 0 if the tap would wrap inside the block
+ short * p=(short *)spuMem;
+ const int iA=rvb_wrap((iOff*4)+rvb.CurrAddr+iAdd);
+ const int iE=rvb_wrap((iOff*4)+rvb.CurrAddr+iAdd+iSteps-1);
+ if(iE-iA!=iSteps-1) return 0;                         // all wraps are jumps back, so a linear range means: no wrap
+ return p+iA;
+}
 
-       const int IIR_A0 = (IIR_INPUT_A0 * rvb.IIR_ALPHA)/32768L + (g_buffer(rvb.IIR_DEST_A0) * (32768L - rvb.IIR_ALPHA))/32768L;
-       const int IIR_A1 = (IIR_INPUT_A1 * rvb.IIR_ALPHA)/32768L + (g_buffer(rvb.IIR_DEST_A1) * (32768L - rvb.IIR_ALPHA))/32768L;
-       const int IIR_B0 = (IIR_INPUT_B0 * rvb.IIR_ALPHA)/32768L + (g_buffer(rvb.IIR_DEST_B0) * (32768L - rvb.IIR_ALPHA))/32768L;
-       const int IIR_B1 = (IIR_INPUT_B1 * rvb.IIR_ALPHA)/32768L + (g_buffer(rvb.IIR_DEST_B1) * (32768L - rvb.IIR_ALPHA))/32768L;
+////////////////////////////////////////////////////////////////////////
+// NEILL'S REVERB: one 22 khz step, every access wrapped on its own
+////////////////////////////////////////////////////////////////////////
 
-       s_buffer1(rvb.IIR_DEST_A0, IIR_A0);
-       s_buffer1(rvb.IIR_DEST_A1, IIR_A1);
-       s_buffer1(rvb.IIR_DEST_B0, IIR_B0);
-       s_buffer1(rvb.IIR_DEST_B1, IIR_B1);
+INLINE void REVERBStep(const int INPUT_SAMPLE_L,const int INPUT_SAMPLE_R)
+{
+ int ACC0,ACC1,FB_A0,FB_A1,FB_B0,FB_B1;
+
+ const int IIR_INPUT_A0 = (g_buffer(rvb.IIR_SRC_A0) * rvb.IIR_COEF)/32768L + (INPUT_SAMPLE_L * rvb.IN_COEF_L)/32768L;
+ const int IIR_INPUT_A1 = (g_buffer(rvb.IIR_SRC_A1) * rvb.IIR_COEF)/32768L + (INPUT_SAMPLE_R * rvb.IN_COEF_R)/32768L;
+ const int IIR_INPUT_B0 = (g_buffer(rvb.IIR_SRC_B0) * rvb.IIR_COEF)/32768L + (INPUT_SAMPLE_L * rvb.IN_COEF_L)/32768L;
+ const int IIR_INPUT_B1 = (g_buffer(rvb.IIR_SRC_B1) * rvb.IIR_COEF)/32768L + (INPUT_SAMPLE_R * rvb.IN_COEF_R)/32768L;
+
+ const int IIR_A0 = (IIR_INPUT_A0 * rvb.IIR_ALPHA)/32768L + (g_buffer(rvb.IIR_DEST_A0) * (32768L - rvb.IIR_ALPHA))/32768L;
+ const int IIR_A1 = (IIR_INPUT_A1 * rvb.IIR_ALPHA)/32768L + (g_buffer(rvb.IIR_DEST_A1) * (32768L - rvb.IIR_ALPHA))/32768L;
+ const int IIR_B0 = (IIR_INPUT_B0 * rvb.IIR_ALPHA)/32768L + (g_buffer(rvb.IIR_DEST_B0) * (32768L - rvb.IIR_ALPHA))/32768L;
+ const int IIR_B1 = (IIR_INPUT_B1 * rvb.IIR_ALPHA)/32768L + (g_buffer(rvb.IIR_DEST_B1) * (32768L - rvb.IIR_ALPHA))/32768L;
+
+ s_buffer1(rvb.IIR_DEST_A0, IIR_A0);
+ s_buffer1(rvb.IIR_DEST_A1, IIR_A1);
+ s_buffer1(rvb.IIR_DEST_B0, IIR_B0);
+ s_buffer1(rvb.IIR_DEST_B1, IIR_B1);
  
-       ACC0 = (g_buffer(rvb.ACC_SRC_A0) * rvb.ACC_COEF_A)/32768L +
-              (g_buffer(rvb.ACC_SRC_B0) * rvb.ACC_COEF_B)/32768L +
-              (g_buffer(rvb.ACC_SRC_C0) * rvb.ACC_COEF_C)/32768L +
-              (g_buffer(rvb.ACC_SRC_D0) * rvb.ACC_COEF_D)/32768L;
-       ACC1 = (g_buffer(rvb.ACC_SRC_A1) * rvb.ACC_COEF_A)/32768L +
-              (g_buffer(rvb.ACC_SRC_B1) * rvb.ACC_COEF_B)/32768L +
-              (g_buffer(rvb.ACC_SRC_C1) * rvb.ACC_COEF_C)/32768L +
-              (g_buffer(rvb.ACC_SRC_D1) * rvb.ACC_COEF_D)/32768L;
-
-       FB_A0 = g_buffer(rvb.MIX_DEST_A0 - rvb.FB_SRC_A);
-       FB_A1 = g_buffer(rvb.MIX_DEST_A1 - rvb.FB_SRC_A);
-       FB_B0 = g_buffer(rvb.MIX_DEST_B0 - rvb.FB_SRC_B);
-       FB_B1 = g_buffer(rvb.MIX_DEST_B1 - rvb.FB_SRC_B);
-
-       s_buffer(rvb.MIX_DEST_A0, ACC0 - (FB_A0 * rvb.FB_ALPHA)/32768L);
-       s_buffer(rvb.MIX_DEST_A1, ACC1 - (FB_A1 * rvb.FB_ALPHA)/32768L);
+ ACC0 = (g_buffer(rvb.ACC_SRC_A0) * rvb.ACC_COEF_A)/32768L +
+        (g_buffer(rvb.ACC_SRC_B0) * rvb.ACC_COEF_B)/32768L +
+        (g_buffer(rvb.ACC_SRC_C0) * rvb.ACC_COEF_C)/32768L +
+        (g_buffer(rvb.ACC_SRC_D0) * rvb.ACC_COEF_D)/32768L;
+ ACC1 = (g_buffer(rvb.ACC_SRC_A1) * rvb.ACC_COEF_A)/32768L +
+        (g_buffer(rvb.ACC_SRC_B1) * rvb.ACC_COEF_B)/32768L +
+        (g_buffer(rvb.ACC_SRC_C1) * rvb.ACC_COEF_C)/32768L +
+        (g_buffer(rvb.ACC_SRC_D1) * rvb.ACC_COEF_D)/32768L;
+
+ FB_A0 = g_buffer(rvb.MIX_DEST_A0 - rvb.FB_SRC_A);
+ FB_A1 = g_buffer(rvb.MIX_DEST_A1 - rvb.FB_SRC_A);
+ FB_B0 = g_buffer(rvb.MIX_DEST_B0 - rvb.FB_SRC_B);
+ FB_B1 = g_buffer(rvb.MIX_DEST_B1 - rvb.FB_SRC_B);
+
+ s_buffer(rvb.MIX_DEST_A0, ACC0 - (FB_A0 * rvb.FB_ALPHA)/32768L);
+ s_buffer(rvb.MIX_DEST_A1, ACC1 - (FB_A1 * rvb.FB_ALPHA)/32768L);
        
-       s_buffer(rvb.MIX_DEST_B0, (rvb.FB_ALPHA * ACC0)/32768L - (FB_A0 * (int)(rvb.FB_ALPHA^0xFFFF8000))/32768L - (FB_B0 * rvb.FB_X)/32768L);
-       s_buffer(rvb.MIX_DEST_B1, (rvb.FB_ALPHA * ACC1)/32768L - (FB_A1 * (int)(rvb.FB_ALPHA^0xFFFF8000))/32768L - (FB_B1 * rvb.FB_X)/32768L);
+ s_buffer(rvb.MIX_DEST_B0, (rvb.FB_ALPHA * ACC0)/32768L - (FB_A0 * (int)(rvb.FB_ALPHA^0xFFFF8000))/32768L - (FB_B0 * rvb.FB_X)/32768L);
+ s_buffer(rvb.MIX_DEST_B1, (rvb.FB_ALPHA * ACC1)/32768L - (FB_A1 * (int)(rvb.FB_ALPHA^0xFFFF8000))/32768L - (FB_B1 * rvb.FB_X)/32768L);
  
-       rvb.iLastRVBLeft  = rvb.iRVBLeft;
-       rvb.iLastRVBRight = rvb.iRVBRight;
+ rvb.iLastRVBLeft  = rvb.iRVBLeft;
+ rvb.iLastRVBRight = rvb.iRVBRight;
 
-       rvb.iRVBLeft  = (g_buffer(rvb.MIX_DEST_A0)+g_buffer(rvb.MIX_DEST_B0))/3;
-       rvb.iRVBRight = (g_buffer(rvb.MIX_DEST_A1)+g_buffer(rvb.MIX_DEST_B1))/3;
+ rvb.iRVBLeft  = (g_buffer(rvb.MIX_DEST_A0)+g_buffer(rvb.MIX_DEST_B0))/3;
+ rvb.iRVBRight = (g_buffer(rvb.MIX_DEST_A1)+g_buffer(rvb.MIX_DEST_B1))/3;
 
-       rvb.iRVBLeft  = (rvb.iRVBLeft  * rvb.VolLeft)  / 0x4000;
-       rvb.iRVBRight = (rvb.iRVBRight * rvb.VolRight) / 0x4000;
+ rvb.iRVBLeft  = (rvb.iRVBLeft  * rvb.VolLeft)  / 0x4000;
+ rvb.iRVBRight = (rvb.iRVBRight * rvb.VolRight) / 0x4000;
+}
 
-       rvb.CurrAddr++;
-       if(rvb.CurrAddr>0x3ffff) rvb.CurrAddr=rvb.StartAddr;
+////////////////////////////////////////////////////////////////////////
+// NEILL'S REVERB: block of 22 khz steps, all wraps resolved up front
+////////////////////////////////////////////////////////////////////////
 
-       return rvb.iLastRVBLeft+(rvb.iRVBLeft-rvb.iLastRVBLeft)/2;
-      }
-     else                                              // -> reverb off
-      {
-       rvb.iLastRVBLeft=rvb.iLastRVBRight=rvb.iRVBLeft=rvb.iRVBRight=0;
-      }
+// the tap pointers for one block: if none of them (and the work
+// address) wraps inside the block, every tap is a plain pointer
+// which simply moves on by one short per 22 khz step
 
-     rvb.CurrAddr++;
-     if(rvb.CurrAddr>0x3ffff) rvb.CurrAddr=rvb.StartAddr;
-    }
+typedef struct
+{
+ short * pIIR_SRC_A0;short * pIIR_SRC_A1;short * pIIR_SRC_B0;short * pIIR_SRC_B1;
+ short * pIIR_DEST_A0;short * pIIR_DEST_A1;short * pIIR_DEST_B0;short * pIIR_DEST_B1;
+ short * pIIR_NEXT_A0;short * pIIR_NEXT_A1;short * pIIR_NEXT_B0;short * pIIR_NEXT_B1;
+ short * pACC_SRC_A0;short * pACC_SRC_B0;short * pACC_SRC_C0;short * pACC_SRC_D0;
+ short * pACC_SRC_A1;short * pACC_SRC_B1;short * pACC_SRC_C1;short * pACC_SRC_D1;
+ short * pFB_A0;short * pFB_A1;short * pFB_B0;short * pFB_B1;
+ short * pMIX_DEST_A0;short * pMIX_DEST_A1;short * pMIX_DEST_B0;short * pMIX_DEST_B1;
+} REVERBTaps;
+
+INLINE int SetupREVERBTaps(REVERBTaps * t,int iSteps)
+{
+ if(rvb.CurrAddr+iSteps-1>0x3FFFF) return 0;           // work address will wrap in this block
+
+#define RVBTAP(p,o,a) if(!(t->p=b_buffer(o,a,iSteps))) return 0;
+
+ RVBTAP(pIIR_SRC_A0,rvb.IIR_SRC_A0,0);  RVBTAP(pIIR_SRC_A1,rvb.IIR_SRC_A1,0);
+ RVBTAP(pIIR_SRC_B0,rvb.IIR_SRC_B0,0);  RVBTAP(pIIR_SRC_B1,rvb.IIR_SRC_B1,0);
+ RVBTAP(pIIR_DEST_A0,rvb.IIR_DEST_A0,0);RVBTAP(pIIR_DEST_A1,rvb.IIR_DEST_A1,0);
+ RVBTAP(pIIR_DEST_B0,rvb.IIR_DEST_B0,0);RVBTAP(pIIR_DEST_B1,rvb.IIR_DEST_B1,0);
+ RVBTAP(pIIR_NEXT_A0,rvb.IIR_DEST_A0,1);RVBTAP(pIIR_NEXT_A1,rvb.IIR_DEST_A1,1);
+ RVBTAP(pIIR_NEXT_B0,rvb.IIR_DEST_B0,1);RVBTAP(pIIR_NEXT_B1,rvb.IIR_DEST_B1,1);
+ RVBTAP(pACC_SRC_A0,rvb.ACC_SRC_A0,0);  RVBTAP(pACC_SRC_B0,rvb.ACC_SRC_B0,0);
+ RVBTAP(pACC_SRC_C0,rvb.ACC_SRC_C0,0);  RVBTAP(pACC_SRC_D0,rvb.ACC_SRC_D0,0);
+ RVBTAP(pACC_SRC_A1,rvb.ACC_SRC_A1,0);  RVBTAP(pACC_SRC_B1,rvb.ACC_SRC_B1,0);
+ RVBTAP(pACC_SRC_C1,rvb.ACC_SRC_C1,0);  RVBTAP(pACC_SRC_D1,rvb.ACC_SRC_D1,0);
+ RVBTAP(pFB_A0,rvb.MIX_DEST_A0-rvb.FB_SRC_A,0);
+ RVBTAP(pFB_A1,rvb.MIX_DEST_A1-rvb.FB_SRC_A,0);
+ RVBTAP(pFB_B0,rvb.MIX_DEST_B0-rvb.FB_SRC_B,0);
+ RVBTAP(pFB_B1,rvb.MIX_DEST_B1-rvb.FB_SRC_B,0);
+ RVBTAP(pMIX_DEST_A0,rvb.MIX_DEST_A0,0);RVBTAP(pMIX_DEST_A1,rvb.MIX_DEST_A1,0);
+ RVBTAP(pMIX_DEST_B0,rvb.MIX_DEST_B0,0);RVBTAP(pMIX_DEST_B1,rvb.MIX_DEST_B1,0);
+
+#undef RVBTAP
+
+ return 1;
+}
 
-   return rvb.iLastRVBLeft;
-  }
- else                                                  // easy fake reverb:
-  {
-   const int iRV=*sRVBPlay;                            // -> simply take the reverb mix buf value
-   *sRVBPlay++=0;                                      // -> init it after
-   if(sRVBPlay>=sRVBEnd) sRVBPlay=sRVBStart;           // -> and take care about wrap arounds
-   return iRV;                                         // -> return reverb mix buf val
-  }
+INLINE void REVERBStepTaps(REVERBTaps * t,const int i,const int INPUT_SAMPLE_L,const int INPUT_SAMPLE_R)
+{
+ // same math as REVERBStep, but the coefs are read once into regs and
+ // the taps are plain pointer accesses (step i of the block)
+
+ const int IIR_COEF=rvb.IIR_COEF,IIR_ALPHA=rvb.IIR_ALPHA,FB_ALPHA=rvb.FB_ALPHA,FB_X=rvb.FB_X;
+ const int IN_L=(INPUT_SAMPLE_L * rvb.IN_COEF_L)/32768L;
+ const int IN_R=(INPUT_SAMPLE_R * rvb.IN_COEF_R)/32768L;
+ int ACC0,ACC1,FB_A0,FB_A1,FB_B0,FB_B1;
+
+ const int IIR_A0 = (((t->pIIR_SRC_A0[i] * IIR_COEF)/32768L + IN_L) * IIR_ALPHA)/32768L + (t->pIIR_DEST_A0[i] * (32768L - IIR_ALPHA))/32768L;
+ const int IIR_A1 = (((t->pIIR_SRC_A1[i] * IIR_COEF)/32768L + IN_R) * IIR_ALPHA)/32768L + (t->pIIR_DEST_A1[i] * (32768L - IIR_ALPHA))/32768L;
+ const int IIR_B0 = (((t->pIIR_SRC_B0[i] * IIR_COEF)/32768L + IN_L) * IIR_ALPHA)/32768L + (t->pIIR_DEST_B0[i] * (32768L - IIR_ALPHA))/32768L;
+ const int IIR_B1 = (((t->pIIR_SRC_B1[i] * IIR_COEF)/32768L + IN_R) * IIR_ALPHA)/32768L + (t->pIIR_DEST_B1[i] * (32768L - IIR_ALPHA))/32768L;
+
+ t->pIIR_NEXT_A0[i]=rvb_clip(IIR_A0);
+ t->pIIR_NEXT_A1[i]=rvb_clip(IIR_A1);
+ t->pIIR_NEXT_B0[i]=rvb_clip(IIR_B0);
+ t->pIIR_NEXT_B1[i]=rvb_clip(IIR_B1);
+
+ ACC0 = (t->pACC_SRC_A0[i] * rvb.ACC_COEF_A)/32768L +
+        (t->pACC_SRC_B0[i] * rvb.ACC_COEF_B)/32768L +
+        (t->pACC_SRC_C0[i] * rvb.ACC_COEF_C)/32768L +
+        (t->pACC_SRC_D0[i] * rvb.ACC_COEF_D)/32768L;
+ ACC1 = (t->pACC_SRC_A1[i] * rvb.ACC_COEF_A)/32768L +
+        (t->pACC_SRC_B1[i] * rvb.ACC_COEF_B)/32768L +
+        (t->pACC_SRC_C1[i] * rvb.ACC_COEF_C)/32768L +
+        (t->pACC_SRC_D1[i] * rvb.ACC_COEF_D)/32768L;
+
+ FB_A0 = t->pFB_A0[i];
+ FB_A1 = t->pFB_A1[i];
+ FB_B0 = t->pFB_B0[i];
+ FB_B1 = t->pFB_B1[i];
+
+ t->pMIX_DEST_A0[i]=rvb_clip(ACC0 - (FB_A0 * FB_ALPHA)/32768L);
+ t->pMIX_DEST_A1[i]=rvb_clip(ACC1 - (FB_A1 * FB_ALPHA)/32768L);
+
+ t->pMIX_DEST_B0[i]=rvb_clip((FB_ALPHA * ACC0)/32768L - (FB_A0 * (int)(FB_ALPHA^0xFFFF8000))/32768L - (FB_B0 * FB_X)/32768L);
+ t->pMIX_DEST_B1[i]=rvb_clip((FB_ALPHA * ACC1)/32768L - (FB_A1 * (int)(FB_ALPHA^0xFFFF8000))/32768L - (FB_B1 * FB_X)/32768L);
+
+ rvb.iLastRVBLeft  = rvb.iRVBLeft;
+ rvb.iLastRVBRight = rvb.iRVBRight;
+
+ rvb.iRVBLeft  = ((t->pMIX_DEST_A0[i]+t->pMIX_DEST_B0[i])/3 * rvb.VolLeft)  / 0x4000;
+ rvb.iRVBRight = ((t->pMIX_DEST_A1[i]+t->pMIX_DEST_B1[i])/3 * rvb.VolRight) / 0x4000;
 }
 
+////////////////////////////////////////////////////////////////////////
+// MIX REVERB: adds the reverb of a complete tick (NSSIZE samples) to the
+// SSumL/SSumR mix buffers. Replaces the old per sample MixREVERBLeft/Right
+// funcs, the output is the same.
 ////////////////////////////////////////////////////////////////////////
 
-INLINE int MixREVERBRight(void)
+static int iRVBCnt=0;                                  // 44.1 khz counter, we work on every second sample
+
+INLINE void MixREVERBBlock(void)
 {
- if(iUseReverb==0) return 0;
+ int ns;
+
+ if(iUseReverb==0) return;
  else
  if(iUseReverb==2)                                     // Neill's reverb:
   {
-   int i=rvb.iLastRVBRight+(rvb.iRVBRight-rvb.iLastRVBRight)/2;
-   rvb.iLastRVBRight=rvb.iRVBRight;
-   return i;                                           // -> just return the last right reverb val (little bit scaled by the previous right val)
+   REVERBTaps t;int iSteps,iStep,bTaps;
+
+   if(!rvb.StartAddr)                                  // reverb is off
+    {
+     rvb.iLastRVBLeft=rvb.iLastRVBRight=rvb.iRVBLeft=rvb.iRVBRight=0;
+     return;
+    }
+
+   iSteps=(NSSIZE+((iRVBCnt&1)?0:1))/2;                // 22 khz steps in this tick
+   bTaps=(spuCtrl&0x80)?SetupREVERBTaps(&t,iSteps):0;
+
+   for(ns=0,iStep=0;ns<NSSIZE;ns++)
+    {
+     iRVBCnt++;
+
+     if(iRVBCnt&1)                                     // downsample to 22 khz
+      {
+       if(spuCtrl&0x80)                                // -> reverb on? oki
+        {
+         const int INPUT_SAMPLE_L=*(sRVBStart+(ns<<1));
+         const int INPUT_SAMPLE_R=*(sRVBStart+(ns<<1)+1);
+
+         if(bTaps) REVERBStepTaps(&t,iStep,INPUT_SAMPLE_L,INPUT_SAMPLE_R);
+         else      REVERBStep(INPUT_SAMPLE_L,INPUT_SAMPLE_R);
+
+         SSumL[ns]+=rvb.iLastRVBLeft+(rvb.iRVBLeft-rvb.iLastRVBLeft)/2;
+        }
+       else                                            // -> reverb off
+        {
+         rvb.iLastRVBLeft=rvb.iLastRVBRight=rvb.iRVBLeft=rvb.iRVBRight=0;
+        }
+
+       iStep++;
+       rvb.CurrAddr++;
+       if(rvb.CurrAddr>0x3ffff) rvb.CurrAddr=rvb.StartAddr;
+      }
+     else SSumL[ns]+=rvb.iLastRVBLeft;
+
+     // right: the last right reverb val (little bit scaled by the previous right val)
+     SSumR[ns]+=rvb.iLastRVBRight+(rvb.iRVBRight-rvb.iLastRVBRight)/2;
+     rvb.iLastRVBRight=rvb.iRVBRight;
+    }
   }
  else                                                  // easy fake reverb:
   {
-   const int iRV=*sRVBPlay;                            // -> simply take the reverb mix buf value
-   *sRVBPlay++=0;                                      // -> init it after
-   if(sRVBPlay>=sRVBEnd) sRVBPlay=sRVBStart;           // -> and take care about wrap arounds
-   return iRV;                                         // -> return reverb mix buf val
+   for(ns=0;ns<NSSIZE;ns++)
+    {
+     SSumL[ns]+=*sRVBPlay;                             // -> simply take the reverb mix buf value
+     *sRVBPlay++=0;                                    // -> init it after
+     if(sRVBPlay>=sRVBEnd) sRVBPlay=sRVBStart;         // -> and take care about wrap arounds
+     SSumR[ns]+=*sRVBPlay;
+     *sRVBPlay++=0;
+     if(sRVBPlay>=sRVBEnd) sRVBPlay=sRVBStart;
+    }
   }
 }
 
@@ -27,4 +27,6 @@
 
 void SetupTimer(void);
 void RemoveTimer(void);
+void PauseTimer(void);
+void ResumeTimer(void);
 void CALLBACK PEOPS_SPUplayADPCMchannel(xa_decode_t *xap);
@@ -19,6 +19,9 @@
 //*************************************************************************//
 // History of changes:
 //
+// 2026/10/19 - pcsxgc
+// - added a CDDA stream, fed by the cd plugin and mixed like XA
+//
 // 2003/02/18 - kode54
 // - added gaussian interpolation
 //
@@ -50,6 +53,11 @@ unsigned long   XALastVal = 0;
 int             iLeftXAVol  = 32767;
 int             iRightXAVol = 32767;
 
+unsigned long * CDDAFeed  = NULL;
+unsigned long * CDDAPlay  = NULL;
+unsigned long * CDDAStart = NULL;
+unsigned long * CDDAEnd   = NULL;
+
 static int gauss_ptr = 0;
 static int gauss_window[8] = {0, 0, 0, 0, 0, 0, 0, 0};
 
@@ -85,6 +93,52 @@ INLINE void MixXA(void)
   }
 }
 
+////////////////////////////////////////////////////////////////////////
+// MIX CDDA
+////////////////////////////////////////////////////////////////////////
+
+INLINE void MixCDDA(void)
+{
+ int ns;
+ unsigned long l;
+
+ for(ns=0;ns<NSSIZE && CDDAPlay!=CDDAFeed;ns++)
+  {
+   l=*CDDAPlay++;
+   if(CDDAPlay==CDDAEnd) CDDAPlay=CDDAStart;
+   SSumL[ns]+=(((short)(l&0xffff))       * iLeftXAVol)/32767; // cd volume regs are
+   SSumR[ns]+=(((short)((l>>16)&0xffff)) * iRightXAVol)/32767;// the xa ones
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// FEED CDDA: 44100 Hz 16 bit stereo, little endian as on the disc.
+// Returns 0x7761 if there is no room, the cd plugin tries again later
+////////////////////////////////////////////////////////////////////////
+
+INLINE int FeedCDDA(unsigned char *pcm, int nBytes)
+{
+ unsigned long * pFeed=CDDAFeed;
+ int iPlace;
+
+ if(!bSPUIsOpen || !CDDAStart) return 0x7761;       // closed: CDDAStart is freed
+
+ if(pFeed<CDDAPlay) iPlace=CDDAPlay-pFeed-1;           // how much space in my buf?
+ else               iPlace=(CDDAEnd-pFeed)+(CDDAPlay-CDDAStart)-1;
+
+ if(iPlace<nBytes/4) return 0x7761;
+
+ while(nBytes>=4)
+  {
+   *pFeed++=pcm[0]|(pcm[1]<<8)|(pcm[2]<<16)|((unsigned long)pcm[3]<<24);
+   if(pFeed==CDDAEnd) pFeed=CDDAStart;
+   pcm+=4;nBytes-=4;
+  }
+
+ CDDAFeed=pFeed;                                       // only now the mixer sees it
+ return 0;
+}
+
 ////////////////////////////////////////////////////////////////////////
 // FEED XA 
 ////////////////////////////////////////////////////////////////////////
@@ -175,6 +175,13 @@ char *biosC0n[256] = {
 #define Rv0 ((char*)SANE_PSXM(v0))
 #define Rsp ((char*)SANE_PSXM(sp))
 
+// The HLE calls write RAM past psxMemWrite*, so they mark what they
+// write themselves for the delta states
+static __inline void biosDirty(void *ptr, u32 size) {
+	if ((u8*)ptr >= (u8*)psxM && (u8*)ptr < (u8*)psxM + 0x00200000)
+		psxMemMarkDirtyRange((u8*)ptr - (u8*)psxM, size);
+}
+
 
 typedef struct {
 	u32 desc;
@@ -323,6 +330,7 @@ void psxBios_setjmp() { // 13
 	for (i=0; i<8; i++) // s0-s7
 		jmp_buf[3+i] = psxRegs.GPR.r[16+i];
 	jmp_buf[11] = gp;
+	biosDirty(jmp_buf, 12*4);
 
 	v0 = 0; pc0 = ra;
 }
@@ -351,10 +359,11 @@ void psxBios_strcat() { // 0x15
 #endif
 
 	strcat(Ra0, Ra1);
+	biosDirty(Ra0, strlen(Ra0) + 1);
 	v0 = a0; pc0 = ra;
 }
 
-/*0x16*/void psxBios_strncat() { strncat(Ra0, Ra1, a2); v0 = a0; pc0 = ra;}
+/*0x16*/void psxBios_strncat() { strncat(Ra0, Ra1, a2); biosDirty(Ra0, strlen(Ra0) + 1); v0 = a0; pc0 = ra;}
 
 void psxBios_strcmp() { // 0x17
 #ifdef PSXBIOS_LOG
@@ -374,8 +383,8 @@ void psxBios_strncmp() { // 0x18
 	pc0 = ra;
 }
 
-/*0x19*/void psxBios_strcpy()  { strcpy(Ra0, Ra1); v0 = a0; pc0 = ra;}
-/*0x1a*/void psxBios_strncpy() { strncpy(Ra0, Ra1, a2);  v0 = a0; pc0 = ra;}
+/*0x19*/void psxBios_strcpy()  { strcpy(Ra0, Ra1); biosDirty(Ra0, strlen(Ra0) + 1); v0 = a0; pc0 = ra;}
+/*0x1a*/void psxBios_strncpy() { strncpy(Ra0, Ra1, a2); biosDirty(Ra0, a2); v0 = a0; pc0 = ra;}
 /*0x1b*/void psxBios_strlen()  { v0 = strlen(Ra0); pc0 = ra;}
 
 void psxBios_index() { // 0x1c
@@ -434,9 +443,10 @@ void psxBios_strcspn() { v0 = strcspn((char *)Ra0, (char *)Ra1); pc0 = ra;}/*22*
 void psxBios_strtok() { // 0x23
 	char *pcA0 = (char *)Ra0;
 	char *pcRet = strtok(pcA0, (char *)Ra1);
-	if(pcRet)
+	if(pcRet) {
+		biosDirty(pcRet, strlen(pcRet) + 1);
 		v0 = a0 + pcRet - pcA0;
-	else
+	} else
 		v0 = 0;
     pc0 = ra;
 }
@@ -453,12 +463,12 @@ void psxBios_strstr() { // 0x24
 
 /*0x25*/void psxBios_toupper() {v0 = toupper(a0); pc0 = ra;}
 /*0x26*/void psxBios_tolower() {v0 = tolower(a0); pc0 = ra;}
-/*0x27*/void psxBios_bcopy()   {memcpy(Ra1,Ra0,a2); pc0=ra;}
-/*0x28*/void psxBios_bzero()   {memset(Ra0,0,a1); pc0=ra;}
+/*0x27*/void psxBios_bcopy()   {memcpy(Ra1,Ra0,a2); biosDirty(Ra1,a2); pc0=ra;}
+/*0x28*/void psxBios_bzero()   {memset(Ra0,0,a1); biosDirty(Ra0,a1); pc0=ra;}
 /*0x29*/void psxBios_bcmp()    {v0 = memcmp(Ra0,Ra1,a2); pc0=ra; }
-/*0x2a*/void psxBios_memcpy()  {memcpy(Ra0, Ra1, a2); v0 = a0; pc0 = ra;}
-/*0x2b*/void psxBios_memset()  {memset(Ra0, a1, a2); v0 = a0; pc0 = ra;}
-/*0x2c*/void psxBios_memmove() {memmove(Ra0, Ra1, a2); v0 = a0; pc0 = ra;}
+/*0x2a*/void psxBios_memcpy()  {memcpy(Ra0, Ra1, a2); biosDirty(Ra0, a2); v0 = a0; pc0 = ra;}
+/*0x2b*/void psxBios_memset()  {memset(Ra0, a1, a2); biosDirty(Ra0, a2); v0 = a0; pc0 = ra;}
+/*0x2c*/void psxBios_memmove() {memmove(Ra0, Ra1, a2); biosDirty(Ra0, a2); v0 = a0; pc0 = ra;}
 /*0x2d*/void psxBios_memcmp()  {v0 = memcmp(Ra0, Ra1, a2); pc0 = ra;}  
 
 void psxBios_memchr() { // 2e
@@ -508,6 +518,7 @@ void psxBios_malloc() { // 33
 			if(colflag == 1) {			// collection is over
 				colflag = 0;
 				*newchunk = SWAP32(dsize | 1);
+				biosDirty(newchunk, 4);
 			}
 		}
 
@@ -515,7 +526,7 @@ void psxBios_malloc() { // 33
 		chunk = (u32*)((u32)chunk + csize + 4);
 	}
 	// if neccessary free memory on end of heap
-	if(colflag == 1) *newchunk = SWAP32(dsize | 1);
+	if(colflag == 1) { *newchunk = SWAP32(dsize | 1); biosDirty(newchunk, 4); }
 	
 
 	chunk = heap_addr;
@@ -540,12 +551,15 @@ void psxBios_malloc() { // 33
 	if(dsize == csize) {
 		// chunk has same size
 		*chunk &= 0xfffffffc;
+		biosDirty(chunk, 4);
 	}
 	else {
 		// split free chunk
 		*chunk = SWAP32(dsize);
 		newchunk = (u32*)((u32)chunk + dsize + 4);
 		*newchunk = SWAP32((((csize - dsize - 4) & 0xfffffffc) | 1));
+		biosDirty(chunk, 4);
+		biosDirty(newchunk, 4);
 	}
 
 	// return pointer to allocated memory
@@ -564,6 +578,7 @@ void psxBios_free() { // 34
 	SysPrintf("free %lx: %lx bytes\n", a0, *(u32*)(Ra0-4));
 
 	*(u32*)(Ra0-4) |= 1;	// set chunk to free
+	biosDirty(Ra0-4, 4);
 	pc0 = ra;
 }
 
@@ -575,6 +590,7 @@ void psxBios_calloc() { // 37
 	a0 = a0 * a1;
 	psxBios_malloc();
 	memset(Rv0, 0, a0);
+	biosDirty(Rv0, a0);
 }
 
 void psxBios_realloc() { // 38
@@ -609,6 +625,7 @@ void psxBios_InitHeap() { // 39
 	heap_addr = (u32*)Ra0;
 	heap_end = (u32*)((u32)heap_addr + size);
 	*heap_addr = SWAP32(size | 1);
+	biosDirty(heap_addr, 4);
 
 	SysPrintf("InitHeap %lx,%lx : %lx %lx\n",a0,a1, (u32)heap_addr-(u32)psxM, size);
 
@@ -698,6 +715,7 @@ void psxBios_Load() { // 42
 
 	if (LoadCdromFile(Ra0, &eheader) == 0) {
 		memcpy(Ra1, ((char*)&eheader)+16, sizeof(EXEC));
+		biosDirty(Ra1, sizeof(EXEC));
 		v0 = 1;
 	} else v0 = 0;
 
@@ -722,6 +740,7 @@ void psxBios_Exec() { // 43
 	header->_gp = gp;
 	header->ret = ra;
 	header->base = s0;
+	biosDirty(header, sizeof(EXEC));
 
 	if (header->S_addr != 0) {
 		tmp = header->S_addr + header->s_size;
@@ -889,12 +908,14 @@ void psxBios_SetMem() { // 9f
 		case 2:
 			psxHu32ref(0x1060) = SWAP32(new);
 			psxMu32ref(0x060) = a0;
+			psxMemMarkDirtyRange(0x060, 4);
 			SysPrintf("Change effective memory : %d MBytes\n",a0);
 			break;
 	
 		case 8:
 			psxHu32ref(0x1060) = SWAP32(new | 0x300);
 			psxMu32ref(0x060) = a0;
+			psxMemMarkDirtyRange(0x060, 4);
 			SysPrintf("Change effective memory : %d MBytes\n",a0);
 	
 		default:
@@ -1243,6 +1264,7 @@ void psxBios_PAD_init() { // 15
 	psxHwWrite16(0x1f801074, (u16)(psxHwRead16(0x1f801074) | 0x1));
 	pad_buf = (int*)Ra1;
 	*pad_buf = -1;
+	biosDirty(pad_buf, 4);
 	psxRegs.CP0.n.Status |= 0x401;
 	pc0 = ra;
 }
@@ -1397,6 +1419,7 @@ void psxBios_lseek() { // 0x33
 	SysPrintf("read %d: %x,%x (%s)\n", FDesc[1 + mcd].mcfile, FDesc[1 + mcd].offset, a2, Mcd##mcd##Data + 128 * FDesc[1 + mcd].mcfile + 0xa); \
 	ptr = Mcd##mcd##Data + 8192 * FDesc[1 + mcd].mcfile + FDesc[1 + mcd].offset; \
 	memcpy(Ra1, ptr, a2); \
+	biosDirty(Ra1, a2); \
 	if (FDesc[1 + mcd].mode & 0x8000) v0 = 0; \
 	else v0 = a2; \
 	DeliverEvent(0x11, 0x2); /* 0xf0000011, 0x0004 */ \
@@ -1516,6 +1539,7 @@ int nfile;
 		SysPrintf("%d : %s = %s + %s (match=%d)\n", nfile, dir->name, pfile, ptr, match); \
 		if (match == 0) continue; \
 		dir->size = 8192; \
+		biosDirty(dir, sizeof(struct DIRENTRY)); \
 		v0 = _dir; \
 		break; \
 	} \
@@ -1684,6 +1708,7 @@ void psxBios__card_read() { // 0x4f
 	} else {
 		memcpy(Ra2, Mcd2Data + a1 * 128, 128);
 	}
+	biosDirty(Ra2, 128);
 
 	DeliverEvent(0x11, 0x2); // 0xf0000011, 0x0004
 //	DeliverEvent(0x81, 0x2); // 0xf4000001, 0x0004
@@ -1763,6 +1788,7 @@ void psxBios_ChangeClearRCnt() { // 0a
 	ptr = (u32*)PSXM((a0 << 2) + 0x8600);
 	v0 = *ptr;
 	*ptr = a1;
+	biosDirty(ptr, 4);
 
 //	psxRegs.CP0.n.Status|= 0x404;
 	pc0 = ra;
@@ -2185,6 +2211,7 @@ __inline void LoadRegs() {
 	while (bufcount--) { \
 		pad_buf##pad[i++] = PAD##pad##_poll(0); \
 	} \
+	biosDirty(pad_buf##pad, i); \
 }
 
 void netError();
@@ -2224,6 +2251,7 @@ void biosInterrupt() {
 					*buf|= PAD2_poll(0) << 24;
 					*buf|= PAD2_poll(0) << 16;
 				}
+				biosDirty(buf, 4);
 			} else {
 				u16 data;
 
@@ -2240,6 +2268,7 @@ void biosInterrupt() {
 					netError();
 				if (NET_recvPadData(&((u16*)buf)[1], 2) == -1)
 					netError();
+				biosDirty(buf, 4);
 			}
 
 		}
@@ -2253,6 +2282,7 @@ void biosInterrupt() {
 				netError();
 			if (NET_recvPadData(pad_buf2, 2) == -1)
 				netError();
+			biosDirty(pad_buf2, 34);
 		} else {
 			if (pad_buf1) {
 				psxBios_PADpoll(1);
@@ -2376,7 +2406,8 @@ v0=1;	// HDHOSHY experimental patch: Spongebob, Coldblood, fearEffect, Medievil2
 	} \
 	base+=sizeof(uintptr_t);
 
-void psxBiosFreeze(int Mode) {
+// returns the bytes used at psxR[0x40000]
+int psxBiosFreeze(int Mode) {
 	u32 base = 0x40000;
 
 	bfreezepsxMptr(jmp_int);
@@ -2392,6 +2423,8 @@ void psxBiosFreeze(int Mode) {
 	bfreezes(Thread);
 	bfreezel(&CurThread);
 	bfreezes(FDesc);
+
+	return base - 0x40000;
 }
 
 
@@ -34,7 +34,7 @@ extern char *biosC0n[256];
 void psxBiosInit();
 void psxBiosShutdown();
 void psxBiosException();
-void psxBiosFreeze(int Mode);
+int psxBiosFreeze(int Mode);
 
 extern void (*biosA0[256])();
 extern void (*biosB0[256])();
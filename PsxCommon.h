@@ -113,6 +113,12 @@ typedef struct {
 	long RCntFix;
 	long UseNet;
 	long VSyncWA;
+	long CdrSpeedup;	/* cd delays divided by this, 0 or 1 = real drive */
+	long Rewind;		/* frames between rewind states, 0 = no rewind */
+	long RunAhead;		/* frames emulated ahead of the one shown, 0 = off */
+	long McdSync;		/* fsync the memory cards after writing them */
+	long BiosCache;		/* boot from the cached post-BIOS state */
+	long AutoSave;		/* vsyncs between autosaves, 0 = off */
 } PcsxConfig;
 
 PcsxConfig Config;
@@ -122,12 +128,29 @@ extern int StatesC;
 extern int cdOpenCase;
 extern int NetOpened;
 
+/* a save state stream: the gz file f, or the buffer mem when it is set;
+   sectioned states know each freeze's size and need no padding, STv3
+   ones lack what the freezes saved since; version is that of the
+   section being loaded, 0 for this build's */
+typedef struct {
+	gzFile f;
+	unsigned char *mem;
+	long pos, size;
+	int sectioned;
+	int v3;
+	int version;
+} freezeFile;
+
+void freezeData(freezeFile *f, void *ptr, long size, int Mode);
+
 #define gzfreeze(ptr, size) \
-	if (Mode == 1) gzwrite(f, ptr, size); \
-	if (Mode == 0) gzread(f, ptr, size);
+	freezeData(f, ptr, size, Mode);
 
 #define gzfreezel(ptr) gzfreeze(ptr, sizeof(ptr))
 
+#define gzfreezepad(ptr) \
+	if (!f->sectioned) gzfreezel(ptr);
+
 //#define BIAS	4
 #define BIAS	2
 #define PSXCLK	33868800	/* 33.8688 Mhz */
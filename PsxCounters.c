@@ -23,6 +23,11 @@
 */
 
 #include "PsxCounters.h"
+#include "Rewind.h"
+#include "RunAhead.h"
+#include "Movie.h"
+#include "Branch.h"
+#include "Sio.h"
 
 static int cnts = 4;
 psxCounter psxCounters[5];
@@ -123,8 +128,25 @@ void psxRcntUpdate() {
 			psxCounters[3].mode&=~0x10000;
 			psxUpdateVSyncRate();
 			psxRcntUpd(3);
-			GPU_updateLace(); // updateGPU
-			SysUpdate();
+			if (runAheadActive) {
+				GPU_updateLace();
+				RunAheadVSync();
+			} else {
+				// with run-ahead, what is shown is the last frame ahead
+				if (Config.RunAhead) GPU_setOutput(0);
+				GPU_updateLace(); // updateGPU
+				if (Config.RunAhead) GPU_setOutput(1);
+				// branches are tried and dropped, nothing keeps them
+				if (!branchActive) {
+					RewindFrame();
+					AutoStateFrame();
+				}
+				MovieFrame();
+				BranchFrame();
+				UpdateMcds();
+				SysUpdate();
+				if (Config.RunAhead && !branchActive) runAheadDue = 1;
+			}
 #ifdef GTE_LOG
 			GTE_LOG("VSync\n");
 #endif
@@ -235,11 +257,11 @@ u32 psxRcntRcount(u32 index) {
 	return ret;
 }
 
-int psxRcntFreeze(gzFile f, int Mode) {
+int psxRcntFreeze(freezeFile *f, int Mode) {
 	char Unused[4096 - sizeof(psxCounter)];
 
 	gzfreezel(psxCounters);
-	gzfreezel(Unused);
+	gzfreezepad(Unused);
 
 	return 0;
 }
@@ -41,7 +41,7 @@ void psxRcntWcount(u32 index, u32 value);
 void psxRcntWmode(u32 index, u32 value);
 void psxRcntWtarget(u32 index, u32 value);
 u32 psxRcntRcount(u32 index);
-int psxRcntFreeze(gzFile f, int Mode);
+int psxRcntFreeze(freezeFile *f, int Mode);
 
 void psxUpdateVSyncRate();
 
@@ -60,6 +60,7 @@ void psxDma4(u32 madr, u32 bcr, u32 chcr) { // SPU
 			size = (bcr >> 16) * (bcr & 0xffff) * 2;
     		SPU_readDMAMem(ptr, size);
 			psxCpu->Clear(madr, size);
+			psxMemMarkDirtyRange(madr, size * 2);
 			break;
 
 #ifdef PSXDMA_LOG
@@ -92,6 +93,7 @@ void psxDma2(u32 madr, u32 bcr, u32 chcr) { // GPU
 			size = (bcr >> 16) * (bcr & 0xffff);
 			GPU_readDataMem((unsigned long*)ptr, size);
 			psxCpu->Clear(madr, size);
+			psxMemMarkDirtyRange(madr, size * 4);
 			break;
 
 		case 0x01000201: // mem2vram
@@ -151,6 +153,7 @@ void psxDma6(u32 madr, u32 bcr, u32 chcr) {
 			return;
 		}
 
+		psxMemMarkDirtyRange(madr - (bcr - 1) * 4, bcr * 4);
 		while (bcr--) {
 			*mem-- = SWAP32((madr - 4) & 0xffffff);
 			madr -= 4;
@@ -714,10 +714,10 @@ void psxHwWrite32(u32 add, u32 value) {
 #endif
 }
 
-int psxHwFreeze(gzFile f, int Mode) {
+int psxHwFreeze(freezeFile *f, int Mode) {
 	char Unused[4096];
 
-	gzfreezel(Unused);
+	gzfreezepad(Unused);
 
 	return 0;
 }
@@ -26,6 +26,9 @@
 #include "R3000A.h"
 #include "Gte.h"
 #include "PsxHLE.h"
+#include "Rewind.h"
+#include "RunAhead.h"
+#include "Branch.h"
 
 static int branch = 0;
 static int branch2 = 0;
@@ -766,11 +769,6 @@ static int intInit() {
 static void intReset() {
 }
 
-static void intExecute() {
-	for (;;) 
-		execI();
-}
-
 static void intExecuteDbg() {
 	/*for (;;) 
 		execIDbg();*/
@@ -781,6 +779,15 @@ static void intExecuteBlock() {
 	while (!branch2) execI();
 }
 
+static void intExecute() {
+	for (;;) {
+		intExecuteBlock();
+		if (rewindDue) RewindStep();
+		if (branchDue) BranchStep();
+		if (runAheadDue) RunAhead(Config.RunAhead);
+	}
+}
+
 static void intExecuteBlockDbg() {
 	/*branch2 = 0;
 	while (!branch2) execIDbg();*/
@@ -50,6 +50,30 @@
 
 extern void SysMessage(char *fmt, ...);
 
+u32 psxMemDirty[PSXMEM_PAGES / 32];
+
+// for the DMA and other writes that don't go through psxMemWrite*
+void psxMemMarkDirtyRange(u32 mem, u32 size) {
+	u32 page, last;
+
+	if (size == 0) return;
+
+	page = (mem & 0x1fffff) >> PSXMEM_PAGE_SHIFT;
+	last = ((mem & 0x1fffff) + size - 1) >> PSXMEM_PAGE_SHIFT;
+	if (last >= PSXMEM_PAGES) { psxMemDirtyAll(); return; }
+
+	for (; page <= last; page++)
+		psxMemDirty[page >> 5] |= 1 << (page & 31);
+}
+
+void psxMemDirtyClear() {
+	memset(psxMemDirty, 0, sizeof(psxMemDirty));
+}
+
+void psxMemDirtyAll() {
+	memset(psxMemDirty, 0xff, sizeof(psxMemDirty));
+}
+
 int psxMemInit() {
 	int i;
 
@@ -96,6 +120,7 @@ void psxMemReset() {
 
 	memset(psxM, 0, 0x00200000);
 	memset(psxP, 0, 0x00010000);
+	psxMemDirtyAll();
 
 	if (strcmp(Config.Bios, "HLE")) {
 		sprintf (bios,"%s%s",Config.BiosDir, Config.Bios);
@@ -206,6 +231,7 @@ void psxMemWrite8(u32 mem, u8 value) {
 		p = (char *)(psxMemWLUT[t]);
 		if (p != NULL) {
 			*(u8  *)(p + (mem & 0xffff)) = value;
+			psxMemMarkDirty(mem);
 #ifdef PSXREC
 			psxCpu->Clear((mem&(~3)), 1);
 #endif
@@ -231,6 +257,7 @@ void psxMemWrite16(u32 mem, u16 value) {
 		p = (char *)(psxMemWLUT[t]);
 		if (p != NULL) {
 			*(u16 *)(p + (mem & 0xffff)) = SWAPu16(value);
+			psxMemMarkDirty(mem);
 #ifdef PSXREC
 			psxCpu->Clear((mem&(~1)), 1);
 #endif
@@ -257,6 +284,7 @@ void psxMemWrite32(u32 mem, u32 value) {
 		p = (char *)(psxMemWLUT[t]);
 		if (p != NULL) {
 			*(u32 *)(p + (mem & 0xffff)) = SWAPu32(value);
+			psxMemMarkDirty(mem);
 #ifdef PSXREC
 			psxCpu->Clear(mem, 1);
 #endif
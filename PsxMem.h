@@ -124,6 +124,19 @@ u8** psxMemRLUT;
 #define PSXREC
 #endif
 
+/* 4KB pages of psxM written since psxMemDirtyClear, for delta states */
+#define PSXMEM_PAGE_SHIFT	12
+#define PSXMEM_PAGES		(0x00200000 >> PSXMEM_PAGE_SHIFT)
+
+extern u32 psxMemDirty[PSXMEM_PAGES / 32];
+
+#define psxMemMarkDirty(mem) \
+	psxMemDirty[((mem) & 0x1fffff) >> (PSXMEM_PAGE_SHIFT + 5)] |= 1 << ((((mem) & 0x1fffff) >> PSXMEM_PAGE_SHIFT) & 31)
+
+void psxMemMarkDirtyRange(u32 mem, u32 size);
+void psxMemDirtyClear();
+void psxMemDirtyAll();
+
 int  psxMemInit();
 void psxMemReset();
 void psxMemShutdown();
@@ -27,6 +27,12 @@
 #include "PsxDma.h"
 #include "CdRom.h"
 #include "Mdec.h"
+#include "Rewind.h"
+#include "RunAhead.h"
+#include "Movie.h"
+#include "Branch.h"
+#include "Sio.h"
+#include "Misc.h"
 
 psxRegisters psxRegs;
 
@@ -61,15 +67,29 @@ void psxReset() {
 	psxHwReset();
 	psxBiosInit();
 
-	if (!Config.HLE) psxExecuteBios();
+	// the BIOS state cache freezes the plugins: psxReset only runs once
+	// OpenPlugins has (SysReset after it in main, the reset paths later)
+	if (!Config.HLE && LoadBiosState() == -1) {
+		psxExecuteBios();
+		SaveBiosState();
+	}
 
 #ifdef EMU_LOG
 	EMU_LOG("*BIOS END*\n");
 #endif
 	Log=0;
+
+	RewindInit(Config.Rewind, 0);
 }
 
 void psxShutdown() {
+	MovieStop();
+	BranchShutdown();
+	SaveStateWait();
+	FlushMcds();
+	RewindShutdown();
+	RunAheadShutdown();
+	AutoStateShutdown();
 	psxMemShutdown();
 	psxBiosShutdown();
 
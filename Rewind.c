@@ -0,0 +1,294 @@
+/***************************************************************************
+ *   Copyright (C) 2007 Ryan Schultz, PCSX-df Team, PCSX team              *
+ *   schultz.ryan@gmail.com, http://rschultz.ath.cx/code.php               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+* Rewind: every interval frames an in-memory state is taken. The newest
+* one is kept whole, each older one only as the zlib compressed xor
+* against the state after it, in a ring that drops the oldest states
+* once the compressed size goes over the cap. A step back xors the
+* newest delta into the whole state and loads the result.
+* The xor and compression run on a worker thread, the emulation only
+* copies the state; a state due while the worker is busy is skipped.
+* While the frontend holds rewind, every vsync marks a step due instead
+* of counting towards a state, and the cpu's execute loop takes it
+* between two blocks.
+*/
+
+#include <malloc.h>
+#include <sys/time.h>
+
+#include "Rewind.h"
+#include "Misc.h"
+
+#ifdef __GAMECUBE__
+#include <gccore.h>
+#define REWIND_THREADED
+#endif
+
+#define REWIND_STACK_SIZE (16*1024)
+#define REWIND_PRIORITY 40
+
+RewindStats rewindStats;
+int rewindDue = 0;
+
+typedef struct {
+	unsigned char *data;
+	long size;
+} RewindEntry;
+
+static RewindEntry ring[REWIND_ENTRIES];
+static int ringFirst, ringCount;
+static long ringBytes, ringCap;
+
+static StateMem rwNewest, rwCapture;	// the whole newest state, the one being taken
+static int rwInterval = 0, rwFrames, rwValid, rwHeld;
+static volatile int rwBusy;
+
+#ifdef REWIND_THREADED
+static lwp_t rwThread;
+static sem_t rwWork, rwIdle;
+static volatile int rwQuit;
+static char rwStack[REWIND_STACK_SIZE];
+
+extern long long gettime(void);
+extern unsigned int diff_usec(long long start, long long end);
+#endif
+
+static u32 rewindNow() {
+#ifdef __GAMECUBE__
+	return diff_usec(0, gettime());
+#else
+	struct timeval tv;
+
+	gettimeofday(&tv, 0);
+	return tv.tv_sec * 1000000 + tv.tv_usec;
+#endif
+}
+
+static void rewindDropOldest() {
+	RewindEntry *e = &ring[ringFirst];
+
+	ringBytes -= e->size;
+	free(e->data);
+	e->data = NULL;
+	ringFirst = (ringFirst + 1) % REWIND_ENTRIES;
+	ringCount--;
+}
+
+static void rewindDropAll() {
+	while (ringCount) rewindDropOldest();
+}
+
+// rwNewest becomes the delta to rwCapture, which then is the newest state
+static void rewindCompress() {
+	StateMem tmp;
+	RewindEntry *e;
+	uLongf zsize;
+	u32 *a, *b;
+	long i, n;
+	u32 start = rewindNow();
+
+	if (!rwValid || rwNewest.size != rwCapture.size) {
+		// first state, or the states don't line up: start over
+		rewindDropAll();
+		rwValid = 1;
+		goto swap;
+	}
+
+	a = (u32 *) rwNewest.data; b = (u32 *) rwCapture.data;
+	n = (rwNewest.size + 3) / 4;
+	for (i = 0; i < n; i++) a[i] ^= b[i];
+
+	zsize = compressBound(rwNewest.size);
+	e = &ring[(ringFirst + ringCount) % REWIND_ENTRIES];
+	if (ringCount == REWIND_ENTRIES) rewindDropOldest();
+	e->data = (unsigned char *) malloc(zsize);
+	if (e->data == NULL || compress2(e->data, &zsize, rwNewest.data, rwNewest.size, 1) != Z_OK) {
+		free(e->data);
+		e->data = NULL;
+		rewindDropAll();
+		goto swap;
+	}
+	e->data = (unsigned char *) realloc(e->data, zsize);
+	e->size = zsize;
+	ringBytes += zsize;
+	ringCount++;
+
+	while (ringBytes > ringCap && ringCount > 1) rewindDropOldest();
+
+swap:
+	tmp = rwNewest; rwNewest = rwCapture; rwCapture = tmp;
+
+	rewindStats.entries = ringCount;
+	rewindStats.bytes = ringBytes;
+	rewindStats.compressUs = rewindNow() - start;
+	if (rewindStats.compressUs > rewindStats.compressMaxUs)
+		rewindStats.compressMaxUs = rewindStats.compressUs;
+}
+
+#ifdef REWIND_THREADED
+static void *rewindThread(void *arg) {
+	for (;;) {
+		LWP_SemWait(rwWork);
+		if (rwQuit) break;
+		rewindCompress();
+		rwBusy = 0;
+		LWP_SemPost(rwIdle);
+	}
+	return NULL;
+}
+#endif
+
+static void rewindWait() {
+#ifdef REWIND_THREADED
+	while (rwBusy) LWP_SemWait(rwIdle);
+#endif
+}
+
+int RewindInit(int interval, long maxMemory) {
+	RewindShutdown();
+
+	if (interval <= 0) return 0;
+
+	memset(&rewindStats, 0, sizeof(rewindStats));
+	if (StateMemInit(&rwNewest) == -1 || StateMemInit(&rwCapture) == -1) {
+		StateMemFree(&rwNewest);
+		StateMemFree(&rwCapture);
+		return -1;
+	}
+
+	ringCap = maxMemory > 0 ? maxMemory : REWIND_MEMORY;
+	rwInterval = interval;
+	rwFrames = 0;
+	rwValid = 0;
+	rwBusy = 0;
+
+#ifdef REWIND_THREADED
+	rwQuit = 0;
+	LWP_SemInit(&rwWork, 0, 1);
+	LWP_SemInit(&rwIdle, 0, 1);
+	LWP_CreateThread(&rwThread, rewindThread, NULL, rwStack, REWIND_STACK_SIZE, REWIND_PRIORITY);
+#endif
+
+	return 0;
+}
+
+// forgets the states taken, for a new game
+void RewindReset() {
+	if (!rwInterval) return;
+
+	rewindWait();
+	rewindDropAll();
+	rwValid = 0;
+	rwFrames = 0;
+	rewindStats.entries = rewindStats.bytes = 0;
+}
+
+void RewindShutdown() {
+	if (!rwInterval) return;
+
+	rewindWait();
+#ifdef REWIND_THREADED
+	rwQuit = 1;
+	LWP_SemPost(rwWork);
+	LWP_JoinThread(rwThread, NULL);
+	LWP_SemDestroy(rwWork);
+	LWP_SemDestroy(rwIdle);
+#endif
+	rewindDropAll();
+	StateMemFree(&rwNewest);
+	StateMemFree(&rwCapture);
+	rwInterval = 0;
+}
+
+// the frontend's rewind button, every vsync
+void RewindHold(int held) {
+	rwHeld = held;
+}
+
+// called every vsync
+void RewindFrame() {
+	u32 start;
+
+	if (!rwInterval) return;
+	if (rwHeld) { rewindDue = 1; return; }
+	if (++rwFrames < rwInterval) return;
+
+	if (rwBusy) { rewindStats.skipped++; return; }
+	rwFrames = 0;
+
+	start = rewindNow();
+	if (SnapStateMem(&rwCapture) == -1) return;
+	rewindStats.captures++;
+	rewindStats.captureUs = rewindNow() - start;
+	if (rewindStats.captureUs > rewindStats.captureMaxUs)
+		rewindStats.captureMaxUs = rewindStats.captureUs;
+
+	rwBusy = 1;
+#ifdef REWIND_THREADED
+	LWP_SemPost(rwWork);
+#else
+	rewindCompress();
+	rwBusy = 0;
+#endif
+}
+
+// goes back to the newest state, or if that was just loaded to the one
+// before it; -1 when there is nothing to go back to
+int RewindStep() {
+	RewindEntry *e;
+	uLongf size;
+	u32 *a, *b;
+	long i, n;
+
+	rewindDue = 0;
+	if (!rwInterval) return -1;
+
+	rewindWait();
+	if (!rwValid) return -1;
+
+	if (rwFrames == 0) {
+		if (ringCount == 0) return -1;
+
+		// the newest delta, out into the spare capture buffer
+		e = &ring[(ringFirst + ringCount - 1) % REWIND_ENTRIES];
+		size = rwCapture.alloc;
+		if (uncompress(rwCapture.data, &size, e->data, e->size) != Z_OK ||
+			(long)size != rwNewest.size) {
+			RewindReset();
+			return -1;
+		}
+
+		a = (u32 *) rwNewest.data; b = (u32 *) rwCapture.data;
+		n = (rwNewest.size + 3) / 4;
+		for (i = 0; i < n; i++) a[i] ^= b[i];
+
+		ringBytes -= e->size;
+		free(e->data);
+		e->data = NULL;
+		ringCount--;
+		rewindStats.entries = ringCount;
+		rewindStats.bytes = ringBytes;
+	}
+
+	rwFrames = 0;
+
+	return RestoreStateMem(&rwNewest);
+}
@@ -0,0 +1,50 @@
+/***************************************************************************
+ *   Copyright (C) 2007 Ryan Schultz, PCSX-df Team, PCSX team              *
+ *   schultz.ryan@gmail.com, http://rschultz.ath.cx/code.php               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef __REWIND_H__
+#define __REWIND_H__
+
+#include "PsxCommon.h"
+
+#define REWIND_ENTRIES		256
+#define REWIND_MEMORY		(8*1024*1024)	/* default cap of the compressed states */
+
+typedef struct {
+	u32 captures;		/* states taken */
+	u32 skipped;		/* due while the last one was still compressing */
+	u32 entries;		/* states in the ring */
+	u32 bytes;			/* their compressed size */
+	u32 captureUs;		/* last time the emulation spent taking a state */
+	u32 captureMaxUs;
+	u32 compressUs;		/* last time the worker spent on a state */
+	u32 compressMaxUs;
+} RewindStats;
+
+extern RewindStats rewindStats;
+extern int rewindDue;		/* rewind is held, the execute loop steps back */
+
+int  RewindInit(int interval, long maxMemory);
+void RewindReset();
+void RewindShutdown();
+void RewindHold(int held);
+void RewindFrame();
+int  RewindStep();
+
+#endif /* __REWIND_H__ */
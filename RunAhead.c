@@ -0,0 +1,80 @@
+/***************************************************************************
+ *   Copyright (C) 2007 Ryan Schultz, PCSX-df Team, PCSX team              *
+ *   schultz.ryan@gmail.com, http://rschultz.ath.cx/code.php               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+* Run-ahead hides the game's own input lag: after a real frame, whose
+* input was just read, the state is taken, frames more are emulated
+* silently and only the last of them is shown, then the state goes back.
+* The vsync only marks run-ahead due, the cpu's execute loop runs it
+* between two blocks, so the real frame's psxBranchTest finishes first.
+* Only the RAM pages the ahead frames wrote are copied back.
+*/
+
+#include "RunAhead.h"
+#include "Misc.h"
+
+int runAheadActive = 0;
+int runAheadDue = 0;
+static volatile int runAheadVSync;
+static StateMem raState;
+
+// a vsync while running ahead ends one of the frames
+void RunAheadVSync() {
+	runAheadVSync = 1;
+}
+
+void RunAhead(int frames) {
+	u32 dirty[PSXMEM_PAGES / 32];
+	int i;
+
+	runAheadDue = 0;
+	if (frames <= 0 || runAheadActive) return;
+
+	if (SnapStateMem(&raState) == -1) {
+		SysPrintf("Run-ahead off: no memory for its state\n");
+		StateMemFree(&raState);
+		Config.RunAhead = 0;
+		return;
+	}
+	memcpy(dirty, psxMemDirty, sizeof(dirty));
+	psxMemDirtyClear();
+
+	runAheadActive = 1;
+	SPU_setOutput(0);
+
+	for (i = 0; i < frames; i++) {
+		GPU_setOutput(i == frames - 1);
+		runAheadVSync = 0;
+		while (!runAheadVSync) psxCpu->ExecuteBlock();
+	}
+
+	GPU_setOutput(1);
+	// still active, so the cd freeze leaves the plugin be
+	RestoreStateMemPages(&raState, psxMemDirty);
+	SPU_setOutput(1);
+	runAheadActive = 0;
+
+	// RAM is what it was, so are the pages written since the delta base
+	memcpy(psxMemDirty, dirty, sizeof(dirty));
+}
+
+void RunAheadShutdown() {
+	StateMemFree(&raState);
+}
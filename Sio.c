@@ -24,6 +24,7 @@
 
 #include "Sio.h"
 #include <sys/stat.h>
+#include <unistd.h>
 
 // *** FOR WORKS ON PADS AND MEMORY CARDS *****
 
@@ -361,38 +362,184 @@ void LoadMcd(int mcd, char *str) {
 }
 
 void LoadMcds(char *mcd1, char *mcd2) {
+	FlushMcds();
 	LoadMcd(1, mcd1);
 	LoadMcd(2, mcd2);
 }
 
-void SaveMcd(char *mcd, char *data, uint32_t adr, int size) {
-	FILE *f;
-	
-	f = fopen(mcd, "r+b");
-	if (f != NULL) {
-		struct stat buf;
+/*
+* Memory card writes only go to the card image and mark its 128 byte
+* frames dirty. Once the game has left the card alone for a while, or
+* at the latest after a few seconds of writes, the image is copied and
+* the dirty frames written out in runs, one open per card; on GameCube
+* by a thread, so a save doesn't stall the emulation. FlushMcds writes
+* out what is left (shutdown, which the console's reset and power buttons
+* go through too, card change). While branches run (mcdReadOnly) the
+* writes stay in memory.
+*/
+#ifdef __GAMECUBE__
+#include <gccore.h>
+#define MCD_THREADED
+#define MCD_STACK_SIZE (16*1024)
+#define MCD_PRIORITY 40
+#endif
 
-		if (stat(mcd, &buf) != -1) {
-			if (buf.st_size == MCD_SIZE + 64)
-				fseek(f, adr + 64, SEEK_SET);
-			else if (buf.st_size == MCD_SIZE + 3904)
-				fseek(f, adr + 3904, SEEK_SET);
-			else
-				fseek(f, adr, SEEK_SET);
-		} else 	fseek(f, adr, SEEK_SET);
+#define MCD_FRAMES		(MCD_SIZE / 128)
+#define MCD_IDLE		60		/* vsyncs without writes before a flush */
+#define MCD_MAXAGE		300		/* vsyncs of writes a flush waits at most */
 
-		fwrite(data + adr, 1, size, f);
-		fclose(f);
+typedef struct {
+	char file[MAXPATHLEN];
+	char *data;
+	char *copy;					/* what the flush writes */
+	u32 dirty[MCD_FRAMES / 32];
+	u32 flush[MCD_FRAMES / 32];
+	int written;				/* dirty frames not taken yet */
+	int idle, age;				/* vsyncs since the last write, the first */
+	int pending;				/* taken, not written out yet */
+} McdCache;
+
+int mcdReadOnly = 0;
+
+static McdCache mcdCache[2];
+static volatile int mcdBusy;
+
+static void mcdWrite(McdCache *c) {
+	FILE *f;
+	struct stat buf;
+	long offset = 0;
+	int i, start;
+
+	f = fopen(c->file, "r+b");
+	if (f == NULL) {
+		// try to create it again if we can't open it
+		ConvertMcd(c->file, c->copy);
 		return;
 	}
 
-	// try to create it again if we can't open it
-	/*f = fopen(mcd, "wb");
-	if (f != NULL) {
-		fwrite(data, 1, MCD_SIZE, f);
-		fclose(f);
-	}*/
-	ConvertMcd(mcd, data);
+	if (stat(c->file, &buf) != -1) {
+		if (buf.st_size == MCD_SIZE + 64) offset = 64;
+		else if (buf.st_size == MCD_SIZE + 3904) offset = 3904;
+	}
+
+	for (i = 0; i < MCD_FRAMES; ) {
+		if (!(c->flush[i >> 5] & (1 << (i & 31)))) { i++; continue; }
+
+		// a run of dirty frames goes in one write
+		for (start = i; i < MCD_FRAMES && (c->flush[i >> 5] & (1 << (i & 31))); i++);
+		fseek(f, offset + start * 128, SEEK_SET);
+		fwrite(c->copy + start * 128, 1, (i - start) * 128, f);
+	}
+
+	fflush(f);
+	if (Config.McdSync) fsync(fileno(f));
+	fclose(f);
+}
+
+static void mcdDoFlush() {
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		if (!mcdCache[i].pending) continue;
+		mcdWrite(&mcdCache[i]);
+		mcdCache[i].pending = 0;
+	}
+}
+
+#ifdef MCD_THREADED
+static lwp_t mcdThread;
+static int mcdRunning = 0;
+static sem_t mcdWork, mcdIdle;
+static char mcdStack[MCD_STACK_SIZE];
+
+static void *mcdFlushThread(void *arg) {
+	for (;;) {
+		LWP_SemWait(mcdWork);
+		mcdDoFlush();
+		mcdBusy = 0;
+		LWP_SemPost(mcdIdle);
+	}
+	return NULL;
+}
+#endif
+
+static void mcdWait() {
+#ifdef MCD_THREADED
+	while (mcdBusy) LWP_SemWait(mcdIdle);
+#endif
+}
+
+// hands the card's dirty frames to the next flush
+static int mcdTake(McdCache *c) {
+	if (!c->written) return 0;
+
+	if (c->copy == NULL && (c->copy = (char *) malloc(MCD_SIZE)) == NULL) return 0;
+	memcpy(c->copy, c->data, MCD_SIZE);
+	memcpy(c->flush, c->dirty, sizeof(c->flush));
+	memset(c->dirty, 0, sizeof(c->dirty));
+	c->written = 0;
+	c->pending = 1;
+
+	return 1;
+}
+
+void SaveMcd(char *mcd, char *data, uint32_t adr, int size) {
+	McdCache *c = &mcdCache[data == Mcd1Data ? 0 : 1];
+	uint32_t i;
+
+	if (mcdReadOnly || size <= 0) return;
+
+	if (strcmp(c->file, mcd)) {
+		// another card in this slot, the old one's writes go first
+		if (c->written || c->pending) FlushMcds();
+		strncpy(c->file, mcd, MAXPATHLEN - 1);
+	}
+	c->data = data;
+
+	for (i = adr / 128; i <= (adr + size - 1) / 128 && i < MCD_FRAMES; i++)
+		c->dirty[i >> 5] |= 1 << (i & 31);
+
+	if (!c->written) c->age = 0;
+	c->written = 1;
+	c->idle = 0;
+}
+
+// called every vsync
+void UpdateMcds() {
+	McdCache *c;
+	int i, n = 0;
+
+	if (mcdBusy) return;
+
+	for (i = 0; i < 2; i++) {
+		c = &mcdCache[i];
+		if (!c->written) continue;
+		c->idle++; c->age++;
+		if (c->idle >= MCD_IDLE || c->age >= MCD_MAXAGE) n += mcdTake(c);
+	}
+	if (!n) return;
+
+	mcdBusy = 1;
+#ifdef MCD_THREADED
+	if (!mcdRunning) {
+		mcdRunning = 1;
+		LWP_SemInit(&mcdWork, 0, 1);
+		LWP_SemInit(&mcdIdle, 0, 1);
+		LWP_CreateThread(&mcdThread, mcdFlushThread, NULL, mcdStack, MCD_STACK_SIZE, MCD_PRIORITY);
+	}
+	LWP_SemPost(mcdWork);
+#else
+	mcdDoFlush();
+	mcdBusy = 0;
+#endif
+}
+
+// writes out every card write so far, before returning
+void FlushMcds() {
+	mcdWait();
+	mcdTake(&mcdCache[0]);
+	mcdTake(&mcdCache[1]);
+	mcdDoFlush();
 }
 
 void CreateMcd(char *mcd) {
@@ -614,7 +761,7 @@ void GetMcdBlockInfo(int mcd, int block, McdBlock *Info) {
 	strncpy(Info->Name, ptr, 16);
 }
 
-int sioFreeze(gzFile f, int Mode) {
+int sioFreeze(freezeFile *f, int Mode) {
 	char Unused[4096];
 
 	gzfreezel(buf);
@@ -629,7 +776,7 @@ int sioFreeze(gzFile f, int Mode) {
 	gzfreezel(&adrH);
 	gzfreezel(&adrL);
 	gzfreezel(&padst);
-	gzfreezel(Unused);
+	gzfreezepad(Unused);
 
 	return 0;
 }
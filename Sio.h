@@ -68,11 +68,15 @@ unsigned char sioRead8();
 void sioWrite8(unsigned char value);
 void sioWriteCtrl16(unsigned short value);
 void sioInterrupt();
-int sioFreeze(gzFile f, int Mode);
+int sioFreeze(freezeFile *f, int Mode);
+
+extern int mcdReadOnly;
 
 void LoadMcd(int mcd, char *str);
 void LoadMcds(char *mcd1, char *mcd2);
 void SaveMcd(char *mcd, char *data, uint32_t adr, int size);
+void UpdateMcds();
+void FlushMcds();
 void CreateMcd(char *mcd);
 void ConvertMcd(char *mcd, char *data);
 
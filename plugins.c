@@ -138,6 +138,8 @@ void CALLBACK GPU__keypressed(int key) {}
 long CALLBACK GPU__getScreenPic(unsigned char *pMem) { return -1; }
 long CALLBACK GPU__showScreenPic(unsigned char *pMem) { return -1; }
 void CALLBACK GPU__clearDynarec(void (CALLBACK *callback)(void)) { }
+void CALLBACK GPU__setOutput(int on) { }
+void CALLBACK GPU__setDeterministic(int mode) { }
 
 #define LoadGpuSym1(dest, name) \
 	LoadSym(GPU_##dest, GPU##dest, name, 1);
@@ -177,6 +179,8 @@ int LoadGPUplugin(char *GPUdll) {
 	LoadGpuSym0(getScreenPic, "GPUgetScreenPic");
 	LoadGpuSym0(showScreenPic, "GPUshowScreenPic");
 	LoadGpuSym0(clearDynarec, "GPUclearDynarec");
+	LoadGpuSym0(setOutput, "GPUsetOutput");
+	LoadGpuSym0(setDeterministic, "GPUsetDeterministic");
 	LoadGpuSym0(configure, "GPUconfigure");
 	LoadGpuSym0(test, "GPUtest");
 	LoadGpuSym0(about, "GPUabout");
@@ -201,6 +205,7 @@ long CALLBACK CDR__configure(void) { return 0; }
 long CALLBACK CDR__test(void) { return 0; }
 void CALLBACK CDR__about(void) {}
 long CALLBACK CDR__setfilename(char*filename) { return 0; }
+long CALLBACK CDR__getPlayPos(unsigned char *time) { return -1; }
 
 #define LoadCdrSym1(dest, name) \
 	LoadSym(CDR_##dest, CDR##dest, name, 1);
@@ -238,6 +243,7 @@ int LoadCDRplugin(char *CDRdll) {
 	LoadCdrSym0(test, "CDRtest");
 	LoadCdrSym0(about, "CDRabout");
 	LoadCdrSym0(setfilename, "CDRsetfilename");
+	LoadCdrSym0(getPlayPos, "CDRgetPlayPos");
 
 	return 0;
 }
@@ -433,6 +439,10 @@ long CALLBACK SPU__freeze(uint32_t ulFreezeMode, SPUFreeze_t *pF) {
 }
 
 void CALLBACK SPU__registerCallback(void (CALLBACK *callback)(void)) {}
+// no room: the cd plugin waits, there is nobody to play it
+long CALLBACK SPU__playCDDAchannel(short *pcm, int nbytes) { return -1; }
+void CALLBACK SPU__setOutput(int on) { }
+void CALLBACK SPU__setDeterministic(int on) { }
 
 #define LoadSpuSym1(dest, name) \
 	LoadSym(SPU_##dest, SPU##dest, name, 1);
@@ -486,6 +496,9 @@ int LoadSPUplugin(char *SPUdll) {
 	LoadSpuSym0(readDMAMem, "SPUreadDMAMem");
 	LoadSpuSym0(playADPCMchannel, "SPUplayADPCMchannel");
 	LoadSpuSym0(freeze, "SPUfreeze");
+	LoadSpuSym0(playCDDAchannel, "SPUplayCDDAchannel");
+	LoadSpuSym0(setOutput, "SPUsetOutput");
+	LoadSpuSym0(setDeterministic, "SPUsetDeterministic");
 	LoadSpuSym0(registerCallback, "SPUregisterCallback");
 	LoadSpuSymN(async, "SPUasync");
 
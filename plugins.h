@@ -76,6 +76,8 @@ typedef long (CALLBACK* GPUfreeze)(uint32_t, GPUFreeze_t *);
 typedef long (CALLBACK* GPUgetScreenPic)(unsigned char *);
 typedef long (CALLBACK* GPUshowScreenPic)(unsigned char *);
 typedef void (CALLBACK* GPUclearDynarec)(void (CALLBACK *callback)(void));
+typedef void (CALLBACK* GPUsetOutput)(int);
+typedef void (CALLBACK* GPUsetDeterministic)(int);
 
 //plugin stuff From Shadow
 // *** walking in the valley of your darking soul i realize that i was alone
@@ -102,6 +104,8 @@ GPUfreeze        GPU_freeze;
 GPUgetScreenPic  GPU_getScreenPic;
 GPUshowScreenPic GPU_showScreenPic;
 GPUclearDynarec  GPU_clearDynarec;
+GPUsetOutput     GPU_setOutput;
+GPUsetDeterministic GPU_setDeterministic;
 
 //cd rom plugin ;)
 typedef long (CALLBACK* CDRinit)(void);
@@ -118,6 +122,7 @@ typedef void (CALLBACK* CDRabout)(void);
 typedef long (CALLBACK* CDRplay)(unsigned char *);
 typedef long (CALLBACK* CDRstop)(void);
 typedef long (CALLBACK* CDRsetfilename)(char *);
+typedef long (CALLBACK* CDRgetPlayPos)(unsigned char *);
 struct CdrStat {
 	uint32_t Type;
 	uint32_t Status;
@@ -155,6 +160,7 @@ CDRgetBufferSub       CDR_getBufferSub;
 CDRconfigure          CDR_configure;
 CDRabout              CDR_about;
 CDRsetfilename        CDR_setfilename;
+CDRgetPlayPos         CDR_getPlayPos;
 
 // spu plugin
 typedef long (CALLBACK* SPUinit)(void);				
@@ -194,6 +200,9 @@ typedef struct {
 } SPUFreeze_t;
 typedef long (CALLBACK* SPUfreeze)(uint32_t, SPUFreeze_t *);
 typedef void (CALLBACK* SPUasync)(uint32_t);
+typedef long (CALLBACK* SPUplayCDDAchannel)(short *, int);
+typedef void (CALLBACK* SPUsetOutput)(int);
+typedef void (CALLBACK* SPUsetDeterministic)(int);
 
 //SPU POINTERS
 SPUconfigure        SPU_configure;
@@ -224,6 +233,9 @@ SPUplayADPCMchannel SPU_playADPCMchannel;
 SPUfreeze           SPU_freeze;
 SPUregisterCallback SPU_registerCallback;
 SPUasync            SPU_async;
+SPUplayCDDAchannel  SPU_playCDDAchannel;
+SPUsetOutput        SPU_setOutput;
+SPUsetDeterministic SPU_setDeterministic;
 
 // PAD Functions
 
@@ -30,6 +30,9 @@
 #include "reguse.h"
 #include "../R3000A.h"
 #include "../PsxHLE.h"
+#include "../Rewind.h"
+#include "../RunAhead.h"
+#include "../Branch.h"
 
 extern void SysRunGui();
 extern void SysMessage(char *fmt, ...);
@@ -1142,7 +1145,12 @@ __inline static void execute() {
 }
 
 static void recExecute() {
-	for (;;) execute();
+	for (;;) {
+		execute();
+		if (rewindDue) RewindStep();
+		if (branchDue) BranchStep();
+		if (runAheadDue) RunAhead(Config.RunAhead);
+	}
 }
 
 static void recExecuteBlock() {